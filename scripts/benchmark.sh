@@ -38,6 +38,66 @@ do
 done
 echo '>'
 
+# launch barrier benchmark
+echo -ne '< '
+for x in 2 4 8 16 # nr. threads
+do
+	echo -ne $x
+	echo -ne 'th '
+	for m in counting awaker # release mode
+	do
+		echo -ne '.'
+		./barrier_tps.out $x $m $group || exit 1;
+	done
+	echo -ne ' '
+done
+echo '>'
+
+# launch barrier release benchmark
+echo -ne '< '
+for x in 16 64 256 1024 # nr. sleepers
+do
+	echo -ne $x
+	echo -ne 'sl '
+	for m in flat tree # wake-up mode
+	do
+		echo -ne '.'
+		./barrier_release.out $x $m $group || exit 1;
+	done
+	echo -ne ' '
+done
+echo '>'
+
+# launch install startup benchmark
+echo -ne '< '
+for x in 100 1000 5000 # nr. groups
+do
+	echo -ne $x
+	echo -ne 'gr '
+	for m in single batch # install mode
+	do
+		echo -ne '.'
+		./install_startup.out $x $m || exit 1;
+	done
+	echo -ne ' '
+done
+echo '>'
+
+# launch c++ binding benchmark
+echo -ne '< '
+for y in 10 1000 5000 # message size
+do
+	echo -ne $y
+	echo -ne 'B '
+	for m in raw cpp # binding mode
+	do
+		echo -ne '.'
+		./cpp_binding.out 100000 $y $m $group || exit 1;
+	done
+	echo -ne ' '
+done
+echo '>'
+
 # restore previous values
 ../test.out sysfs_write $group max_message_size $msg > /dev/null
 ../test.out sysfs_write $group max_message_size $stor > /dev/null
@@ -12,6 +12,201 @@ struct group_t
 	char devname[26];
 };
 
+// INSTALL_GROUP_FD argument
+struct group_fd_t
+{
+	struct group_t group;
+	int installed;  // out: 1 if the call installed the group
+};
+
+// INSTALL_GROUPS argument
+struct group_batch_t
+{
+	struct group_t *groups;  // in: ids, out: devnames (empty if unresolved)
+	int *fds;  // out, optional: a descriptor per group (-1 if unresolved)
+	unsigned int count;  // up to GROUPS_BATCH_MAX
+	unsigned int installed;  // out: groups installed by the call
+};
+
+#define GROUPS_BATCH_MAX 65536
+
+// GET_CONFIG and SET_CONFIG argument, a snapshot of all group parameters
+struct group_config_t
+{
+	unsigned int mask;  // SET_CONFIG: GROUP_CONFIG_* fields to update
+	unsigned int delay;  // ms
+	unsigned long max_message_size;
+	unsigned long max_storage_size;
+	unsigned long size;  // GET_CONFIG only: bytes of stored messages
+	unsigned long reserved[4];  // future parameters, SET_CONFIG: must be zero
+};
+
+#define GROUP_CONFIG_DELAY				0x1
+#define GROUP_CONFIG_MAX_MESSAGE_SIZE	0x2
+#define GROUP_CONFIG_MAX_STORAGE_SIZE	0x4
+#define GROUP_CONFIG_ALL				0x7
+
+// REGISTER_BUFFERS argument
+struct group_buffer_t
+{
+	void *addr;
+	unsigned long size;
+};
+
+struct group_buffers_t
+{
+	struct group_buffer_t *buffers;  // ids are their indexes
+	unsigned int count;  // up to GROUP_BUFFERS_MAX, 0 unregisters them
+};
+
+#define GROUP_BUFFERS_MAX 1024
+
+// READ_MESSAGES argument
+struct group_delivery_t
+{
+	unsigned int buffer;  // id of the buffer holding the message
+	unsigned int size;
+};
+
+struct group_messages_t
+{
+	struct group_delivery_t *deliveries;  // out: room for max of them
+	unsigned int max;
+	unsigned int flags;
+	unsigned int count;  // out: messages delivered
+};
+
+#define GROUP_MESSAGES_WAIT 0x1  // sleeps until a message is published
+
+// WAIT_MESSAGES argument
+struct group_wait_t
+{
+	unsigned int flags;
+	long long timeout;  // ns, relative or CLOCK_MONOTONIC deadline
+};
+
+#define GROUP_WAIT_TIMED 1  // honour timeout
+#define GROUP_WAIT_ABSTIME 2  // timeout is a deadline
+
+// READ_MESSAGE argument
+struct group_read_t
+{
+	void *buf;
+	unsigned long size;
+	unsigned long msg_size;  // out, on EMSGSIZE: size of the queued message
+};
+
+// GET_STATS argument, counters since the group was installed
+struct group_stats_t
+{
+	unsigned long long msgs_written;
+	unsigned long long bytes_written;
+	unsigned long long msgs_read;
+	unsigned long long bytes_read;
+	unsigned long long msgs_delayed;  // written while a send delay was set
+	unsigned long long msgs_revoked;
+	unsigned long long msgs_flushed;  // delayed ones published by a close
+	unsigned long long rejected_nospc;  // writes failing with ENOSPC
+	unsigned long long rejected_msgsize;  // writes failing with EMSGSIZE
+	unsigned long long barrier_sleeps;
+	unsigned long long barrier_wakeups;  // releases finding kernel sleepers
+	unsigned long size;  // bytes of stored messages
+	unsigned long peak_size;
+};
+
+
+// words shared between kernel and userspace, atomically accessed by both
+#ifdef __KERNEL__
+typedef atomic_t shared32_t;
+typedef atomic64_t shared64_t;
+#else
+typedef unsigned int shared32_t;
+typedef unsigned long long shared64_t;
+#endif
+
+// live group counters, read-only for userspace: the group device maps 
+// them at page 1 + BARRIER_PAYLOAD_PAGES, right after the barrier payloads
+struct group_status_t
+{
+	shared32_t seq;  // odd while the counters are being updated
+	shared32_t ready;  // readable messages, outside seq: checked with a single load
+	unsigned long long published;  // messages made readable so far
+	unsigned long long delivered;  // messages dequeued so far
+	unsigned long long queued;  // readable messages: published - delivered
+	unsigned long long size;  // bytes of stored messages, delayed ones included
+	unsigned long long delayed;  // messages waiting for their delay
+	unsigned long long sleepers;  // threads sleeping on barriers or for messages
+};
+
+// barriers per group, SLEEP_ON_BARRIER and AWAKE_BARRIER act on barrier 0
+#define BARRIERS 64
+
+// barrier state, one cache line each: the group device maps 
+// the page holding all of them, indexed by barrier id
+struct barrier_shm_t
+{
+	// release generation in the upper 32 bits, arrivals in the lower ones: 
+	// every release restarts arrivals from 0, released sleepers never withdraw
+	shared64_t state;
+	shared32_t sleepers;  // threads sleeping in kernel
+	shared32_t parties;  // 0: released by an awaker only
+} __attribute__((aligned(64)));
+
+// largest payload a release can broadcast to its sleepers
+#define BARRIER_PAYLOAD_MAX 112
+
+// payload of a barrier's last broadcasting release, one slot per barrier id: 
+// the group device maps them right after the barrier page
+struct barrier_payload_t
+{
+	shared32_t seq;  // odd while the slot is being written
+	unsigned int generation;  // generation entered by the broadcasting release
+	unsigned int size;
+	unsigned int previous;  // generation entered by the broadcast before
+	char data[BARRIER_PAYLOAD_MAX];
+} __attribute__((aligned(64)));
+
+#define BARRIER_GENERATION (1ULL << 32)
+#define barrier_gen(state) ((unsigned int) ((unsigned long long) (state) >> 32))
+#define barrier_arrivals(state) ((unsigned int) (state))
+#define barrier_next(state) ((unsigned long long) (barrier_gen(state) + 1U) << 32)
+
+// WAIT_ON_BARRIER, SLEEP_ON_BARRIER_TIMED and WATCH_BARRIER argument
+struct barrier_wait_t
+{
+	unsigned int barrier;  // barrier id
+	unsigned int generation;  // sleep while the barrier is at this generation
+	unsigned int flags;
+	long long timeout;  // ns, relative or CLOCK_MONOTONIC deadline
+	
+	// SLEEP_ON_BARRIER_TIMED only, payload of the release (NULL: ignore)
+	void *payload;
+	unsigned int payload_size;  // in: buffer size, out: payload size (0: none)
+};
+
+#define BARRIER_WAIT_TIMED 1  // honour timeout
+#define BARRIER_WAIT_ABSTIME 2  // timeout is a deadline
+#define BARRIER_WATCH_SET 4  // WATCH_BARRIER: replace an earlier watched generation
+
+// SET_BARRIER_PARTIES and SET_BARRIER_MODE argument
+struct barrier_conf_t
+{
+	unsigned int barrier;  // barrier id
+	unsigned int parties;
+	unsigned int mode;  // BARRIER_FLAT or BARRIER_TREE
+};
+
+#define BARRIER_FLAT 0  // one wait queue, the releaser wakes all sleepers
+#define BARRIER_TREE 1  // per NUMA node wait queues, sleepers wake each other
+
+// AWAKE_BARRIER_PAYLOAD argument
+struct barrier_awake_t
+{
+	unsigned int barrier;  // barrier id
+	unsigned int size;  // up to BARRIER_PAYLOAD_MAX
+	const void *payload;
+};
+
 
 // unused magic number
 // check 'https://www.kernel.org/doc/Documentation/ioctl/ioctl-number.txt'
@@ -22,7 +217,33 @@ struct group_t
 #define INSTALL_GROUP					_IOWR(_IOC_MAGIC, 3, struct group_t*)
 #define SET_SEND_DELAY					_IOW(_IOC_MAGIC, 4, unsigned long*)
 #define REVOKE_DELAYED_MESSAGES			_IO(_IOC_MAGIC, 5)
+#define SET_BARRIER_PARTIES				_IOW(_IOC_MAGIC, 6, struct barrier_conf_t*)
+#define WAIT_ON_BARRIER					_IOW(_IOC_MAGIC, 7, struct barrier_wait_t*)
+#define WAKE_BARRIER					_IO(_IOC_MAGIC, 8)  // arg: barrier id
+#define SLEEP_ON_BARRIER_TIMED			_IOW(_IOC_MAGIC, 9, struct barrier_wait_t*)
+#define AWAKE_BARRIER_ID				_IO(_IOC_MAGIC, 10)  // arg: barrier id
+#define SET_BARRIER_MODE				_IOW(_IOC_MAGIC, 11, struct barrier_conf_t*)
+#define AWAKE_BARRIER_PAYLOAD			_IOW(_IOC_MAGIC, 12, struct barrier_awake_t*)
+#define UNINSTALL_GROUP					_IOW(_IOC_MAGIC, 13, struct group_t*)
+#define INSTALL_GROUP_FD				_IOWR(_IOC_MAGIC, 14, struct group_fd_t*)
+#define INSTALL_GROUPS					_IOWR(_IOC_MAGIC, 15, struct group_batch_t*)
+#define EXPORT_GROUP					_IO(_IOC_MAGIC, 16)
+#define GET_CONFIG						_IOR(_IOC_MAGIC, 17, struct group_config_t*)
+#define SET_CONFIG						_IOW(_IOC_MAGIC, 18, struct group_config_t*)
+#define PEEK_MESSAGE_SIZE				_IO(_IOC_MAGIC, 19)
+#define READ_MESSAGE					_IOWR(_IOC_MAGIC, 20, struct group_read_t*)
+#define REGISTER_BUFFERS				_IOW(_IOC_MAGIC, 21, struct group_buffers_t*)
+#define READ_MESSAGES					_IOWR(_IOC_MAGIC, 22, struct group_messages_t*)
+#define GET_STATS						_IOR(_IOC_MAGIC, 23, struct group_stats_t*)
+#define WAIT_MESSAGES					_IOW(_IOC_MAGIC, 24, struct group_wait_t*)
+#define WATCH_BARRIER					_IOW(_IOC_MAGIC, 25, struct barrier_wait_t*)
+#define UNWATCH_BARRIER					_IO(_IOC_MAGIC, 26)
+
+#define _IOC_MAX 26
+
 
-#define _IOC_MAX 5
+// returned by SLEEP_ON_BARRIER to the thread releasing a counting barrier
+// (the analogue of PTHREAD_BARRIER_SERIAL_THREAD)
+#define BARRIER_SERIAL_THREAD 1
 
 #endif /* groups.h */
@@ -0,0 +1,236 @@
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM groups
+
+#if !defined(_GROUPS_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _GROUPS_TRACE_H
+
+#include <linux/tracepoint.h>
+
+/* Group operations, under events/groups/ in tracefs. Groups are named
+ * by minor (-1: groupfs groups), queue depth is the size of their stored
+ * messages (published and delayed ones) in bytes, read locklessly. */
+
+// write(2), ret is the amount of bytes written or the error
+TRACE_EVENT(group_write,
+
+	TP_PROTO(int minor, size_t count, unsigned int delay, unsigned long size, int ret),
+
+	TP_ARGS(minor, count, delay, size, ret),
+
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(size_t, count)
+		__field(unsigned int, delay)
+		__field(unsigned long, size)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->count = count;
+		__entry->delay = delay;
+		__entry->size = size;
+		__entry->ret = ret;
+	),
+
+	TP_printk("minor=%d count=%zu delay=%u size=%lu ret=%d",
+		__entry->minor, __entry->count, __entry->delay, __entry->size, __entry->ret)
+);
+
+// a message dequeued by read(2), READ_MESSAGE or READ_MESSAGES
+TRACE_EVENT(group_read,
+
+	TP_PROTO(int minor, size_t msg_size, size_t count, unsigned long size),
+
+	TP_ARGS(minor, msg_size, count, size),
+
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(size_t, msg_size)
+		__field(size_t, count)
+		__field(unsigned long, size)
+	),
+
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->msg_size = msg_size;
+		__entry->count = count;
+		__entry->size = size;
+	),
+
+	TP_printk("minor=%d msg_size=%zu count=%zu size=%lu",
+		__entry->minor, __entry->msg_size, __entry->count, __entry->size)
+);
+
+// a delayed message published by its timer
+TRACE_EVENT(group_timer_publish,
+
+	TP_PROTO(int minor, size_t msg_size, unsigned long size),
+
+	TP_ARGS(minor, msg_size, size),
+
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(size_t, msg_size)
+		__field(unsigned long, size)
+	),
+
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->msg_size = msg_size;
+		__entry->size = size;
+	),
+
+	TP_printk("minor=%d msg_size=%zu size=%lu",
+		__entry->minor, __entry->msg_size, __entry->size)
+);
+
+DECLARE_EVENT_CLASS(group_delayed,
+
+	TP_PROTO(int minor, unsigned int messages, unsigned long size),
+
+	TP_ARGS(minor, messages, size),
+
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(unsigned int, messages)
+		__field(unsigned long, size)
+	),
+
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->messages = messages;
+		__entry->size = size;
+	),
+
+	TP_printk("minor=%d messages=%u size=%lu",
+		__entry->minor, __entry->messages, __entry->size)
+);
+
+// delayed messages published right away by a close
+DEFINE_EVENT(group_delayed, group_flush,
+	TP_PROTO(int minor, unsigned int messages, unsigned long size),
+	TP_ARGS(minor, messages, size)
+);
+
+// delayed messages discarded by REVOKE_DELAYED_MESSAGES
+DEFINE_EVENT(group_delayed, group_revoke,
+	TP_PROTO(int minor, unsigned int messages, unsigned long size),
+	TP_ARGS(minor, messages, size)
+);
+
+// a thread going to sleep on a barrier generation
+TRACE_EVENT(group_barrier_sleep,
+
+	TP_PROTO(int minor, unsigned int barrier, unsigned int generation, int tree),
+
+	TP_ARGS(minor, barrier, generation, tree),
+
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(unsigned int, barrier)
+		__field(unsigned int, generation)
+		__field(int, tree)
+	),
+
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->barrier = barrier;
+		__entry->generation = generation;
+		__entry->tree = tree;
+	),
+
+	TP_printk("minor=%d barrier=%u generation=%u mode=%s",
+		__entry->minor, __entry->barrier, __entry->generation,
+		__entry->tree ? "tree" : "flat")
+);
+
+// the sleeper back: released (ret 0), timed out or interrupted
+TRACE_EVENT(group_barrier_woken,
+
+	TP_PROTO(int minor, unsigned int barrier, unsigned int generation, int ret),
+
+	TP_ARGS(minor, barrier, generation, ret),
+
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(unsigned int, barrier)
+		__field(unsigned int, generation)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->barrier = barrier;
+		__entry->generation = generation;
+		__entry->ret = ret;
+	),
+
+	TP_printk("minor=%d barrier=%u generation=%u ret=%d",
+		__entry->minor, __entry->barrier, __entry->generation, __entry->ret)
+);
+
+// a release waking kernel sleepers up, as counted by the
+// barrier's sleepers word (tree mode: nodes having sleepers)
+TRACE_EVENT(group_barrier_wake,
+
+	TP_PROTO(int minor, unsigned int barrier, unsigned int sleepers),
+
+	TP_ARGS(minor, barrier, sleepers),
+
+	TP_STRUCT__entry(
+		__field(int, minor)
+		__field(unsigned int, barrier)
+		__field(unsigned int, sleepers)
+	),
+
+	TP_fast_assign(
+		__entry->minor = minor;
+		__entry->barrier = barrier;
+		__entry->sleepers = sleepers;
+	),
+
+	TP_printk("minor=%d barrier=%u sleepers=%u",
+		__entry->minor, __entry->barrier, __entry->sleepers)
+);
+
+DECLARE_EVENT_CLASS(group_install_class,
+
+	TP_PROTO(const char *id, int minor),
+
+	TP_ARGS(id, minor),
+
+	TP_STRUCT__entry(
+		__array(char, id, 33)
+		__field(int, minor)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->id, id, 32);
+		__entry->id[32] = '\0';
+		__entry->minor = minor;
+	),
+
+	TP_printk("id=%s minor=%d", __entry->id, __entry->minor)
+);
+
+// a group installed by INSTALL_GROUP, INSTALL_GROUP_FD or INSTALL_GROUPS
+DEFINE_EVENT(group_install_class, group_install,
+	TP_PROTO(const char *id, int minor),
+	TP_ARGS(id, minor)
+);
+
+DEFINE_EVENT(group_install_class, group_uninstall,
+	TP_PROTO(const char *id, int minor),
+	TP_ARGS(id, minor)
+);
+
+#endif /* _GROUPS_TRACE_H */
+
+// out of tree: found through the module's include path
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE groups_trace
+#include <trace/define_trace.h>
@@ -2,6 +2,12 @@
 #ifndef	_LGROUPS_H
 #define	_LGROUPS_H
 
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
 struct lgroup_t;
 
@@ -36,6 +42,20 @@ void lgroup_destroy(struct lgroup_t *lgroup);
  */
 int publish_message(struct lgroup_t *lgroup, char *msg);
 
+/** 
+ * Posts a message of size bytes, not necessarily 
+ * a string, to the group-shared queue.
+ * 
+ * @param lgroup
+ * @param msg
+ * @param size, at least 2
+ * @return 
+ *		amount of bytes written
+ *		-1: group is not installed
+ *		-2: write fail, check errno
+ */
+int publish_message_n(struct lgroup_t *lgroup, const void *msg, unsigned long size);
+
 /** 
  * Delivers a message from the group-shared queue.
  * 
@@ -49,6 +69,178 @@ int publish_message(struct lgroup_t *lgroup, char *msg);
  */
 int deliver_message(struct lgroup_t *lgroup, char *buf, unsigned long size);
 
+/** 
+ * Size of the next message to be delivered, so that 
+ * buffers can be sized to avoid truncation.
+ * 
+ * @param lgroup
+ * @return 
+ *		message size, 0 if the queue is empty
+ *		-1: group is not installed
+ *		-2: PEEK_MESSAGE_SIZE ioctl failed, check errno
+ */
+int peek_message_size(struct lgroup_t *lgroup);
+
+/** 
+ * Waits for a message to be published, without a system 
+ * call if one is already queued. deliver_message skips 
+ * read() on empty queues the same way, so idle consumers 
+ * can wait here rather than polling.
+ * 
+ * @param lgroup
+ * @param timeout, NULL: no timeout (relative or, with LGROUP_ABSTIME, deadline)
+ * @param flags, 0 or LGROUP_ABSTIME
+ * @return 
+ *		0: a message is published
+ *		-1: group is not installed
+ *		-2: WAIT_MESSAGES ioctl failed, check errno
+ *		-3: timeout expired
+ */
+int wait_messages(struct lgroup_t *lgroup, const struct timespec *timeout, int flags);
+
+/** 
+ * Delivers a message into buf, never truncating it, 
+ * in a single syscall: a message longer than size 
+ * stays queued, its size reported through needed.
+ * 
+ * @param lgroup
+ * @param buf
+ * @param size
+ * @param needed, out: size of the queued message if it doesn't fit, else 0
+ * @return 
+ *		amount of bytes read, 0 if none is published or it doesn't fit
+ *		-1: group is not installed
+ *		-2: READ_MESSAGE ioctl failed, check errno
+ */
+int deliver_message_fit(struct lgroup_t *lgroup, void *buf, unsigned long size, 
+		unsigned long *needed);
+
+/** 
+ * Delivers a message into a buffer of its own size, 
+ * never truncating it.
+ * 
+ * @param lgroup
+ * @param msg, out: the message, to be freed by the caller (NULL if none)
+ * @return 
+ *		amount of bytes read
+ *		-1: group is not installed
+ *		-2: READ_MESSAGE ioctl failed, check errno
+ *		-3: out of memory
+ */
+int deliver_message_alloc(struct lgroup_t *lgroup, char **msg);
+
+/** 
+ * Delivers a message into the smallest of the caller's 
+ * buffers holding it, never truncating it.
+ * 
+ * @param lgroup
+ * @param bufs, count buffers
+ * @param sizes, of each buffer
+ * @param count
+ * @param index, out: buffer holding the message (-1 if none)
+ * @return 
+ *		amount of bytes read
+ *		-1: group is not installed
+ *		-2: READ_MESSAGE ioctl failed, check errno
+ *		-3: no buffer is large enough, the message stays queued
+ */
+int deliver_message_pool(struct lgroup_t *lgroup, char **bufs, const unsigned long *sizes, 
+		unsigned int count, int *index);
+
+// buffers register_buffers can register
+#define LGROUP_BUFFERS_MAX 1024
+
+// a message delivered by deliver_messages
+struct lgroup_delivery_t {
+	unsigned int buffer;  // index of the registered buffer holding it
+	unsigned int size;
+};
+
+/** 
+ * Registers the caller's buffers with the lgroup, to be 
+ * filled directly by deliver_messages. They replace the 
+ * previously registered ones, count 0 unregisters them. 
+ * Buffers must stay valid while registered.
+ * 
+ * @param lgroup
+ * @param bufs, count buffers
+ * @param sizes, of each buffer
+ * @param count, up to LGROUP_BUFFERS_MAX
+ * @return 
+ *		0: success
+ *		-1: group is not installed
+ *		-2: REGISTER_BUFFERS ioctl failed, check errno
+ *		-3: out of memory
+ */
+int register_buffers(struct lgroup_t *lgroup, void **bufs, const unsigned long *sizes, 
+		unsigned int count);
+
+/** 
+ * Delivers up to max messages in a single call, each into the 
+ * smallest registered buffer holding it not used by the call 
+ * yet. Messages are never truncated: delivery stops at the 
+ * first one fitting no buffer left, which stays queued.
+ * 
+ * @param lgroup, with registered buffers
+ * @param deliveries, out: room for max of them
+ * @param max
+ * @param wait, non-zero: sleeps until a message is published
+ * @return 
+ *		amount of messages delivered, 0 if none is published
+ *		-1: group is not installed
+ *		-2: READ_MESSAGES ioctl failed, check errno 
+ *			(ENOBUFS: no buffer registered, EMSGSIZE: no buffer fits)
+ */
+int deliver_messages(struct lgroup_t *lgroup, struct lgroup_delivery_t *deliveries, 
+		unsigned int max, int wait);
+
+/**
+ * Buffers the lgroup's publications through publish_buffered.
+ * 
+ * Messages are flushed as a single syscall once they reach 
+ * bytes or count, or once the oldest of them waited delay ms. 
+ * The buffer is flushed as well by flush_messages and when 
+ * the lgroup is finalized or installed anew.
+ * 
+ * @param lgroup, previously installed
+ * @param bytes, buffer capacity
+ * @param count, up to IOV_MAX
+ * @param delay, ms: 0 flushes on thresholds only
+ * @return 
+ *		0: success
+ *		-1: group is not installed
+ *		-2: already buffered or invalid thresholds
+ *		-3: out of resources
+ */
+int set_publish_buffer(struct lgroup_t *lgroup, unsigned long bytes, 
+		unsigned int count, unsigned int delay);
+
+/** 
+ * Buffers a message of size bytes, not necessarily a string, 
+ * to be posted to the group-shared queue. Messages larger 
+ * than the buffer are posted right away, after buffered ones.
+ * 
+ * @param lgroup, buffered by set_publish_buffer
+ * @param msg
+ * @param size
+ * @return 
+ *		size
+ *		-1: group is not installed or buffered
+ *		-2: a flush dropped some messages, check errno
+ */
+int publish_buffered(struct lgroup_t *lgroup, const void *msg, unsigned long size);
+
+/** 
+ * Posts the buffered messages to the group-shared queue.
+ * 
+ * @param lgroup, buffered by set_publish_buffer
+ * @return 
+ *		amount of messages posted
+ *		-1: group is not installed or buffered
+ *		-2: some messages were dropped, check errno
+ */
+int flush_messages(struct lgroup_t *lgroup);
+
 /**
  * Sets group's delay.
  * 
@@ -75,14 +267,24 @@ int revoke_delayed_messages(struct lgroup_t *lgroup);
 
 // -------------- BARRIER OPERATIONS -------------- //
 
+// barriers per group, sleep_on_barrier and awake_barrier act on barrier 0
+#define LGROUP_BARRIERS 64
+
+// returned by sleep_on_barrier to the last party of a counting barrier
+#define LGROUP_BARRIER_SERIAL_THREAD 1
+
 /**
- * Goes to sleep on a group's barrier.
+ * Goes to sleep on a group's barrier 0.
  * 
  * The function returns after the first 
- * awake_barrier on the same installed group.
+ * awake_barrier on the same installed group or, 
+ * if the barrier counts parties, as soon as 
+ * the last party arrives. The caller spins briefly 
+ * on the mapped barrier page before sleeping in kernel.
  * 
  * @param lgroup, previously installed
  * @return 
+ *		LGROUP_BARRIER_SERIAL_THREAD: success, caller released the barrier
  *		0: success
  *		-1: group is not installed
  *		-2: sleep fail, check errno
@@ -90,18 +292,159 @@ int revoke_delayed_messages(struct lgroup_t *lgroup);
 int sleep_on_barrier(struct lgroup_t *lgroup);
 
 /**
- * Awakes the group's barrier.
+ * Goes to sleep on one of the group's barriers.
+ * 
+ * Same as sleep_on_barrier, on barrier id: each barrier 
+ * is released independently of the others.
+ * 
+ * @param lgroup, previously installed
+ * @param barrier, id < LGROUP_BARRIERS
+ * @return 
+ *		LGROUP_BARRIER_SERIAL_THREAD: success, caller released the barrier
+ *		0: success
+ *		-1: group is not installed
+ *		-2: sleep fail, check errno
+ */
+int sleep_on_barrier_id(struct lgroup_t *lgroup, unsigned int barrier);
+
+// largest payload awake_barrier_payload can broadcast
+#define LGROUP_BARRIER_PAYLOAD_MAX 112
+
+/**
+ * Goes to sleep on one of the group's barriers, receiving 
+ * the payload broadcast by its release.
+ * 
+ * Same as sleep_on_barrier_id. If released by 
+ * awake_barrier_payload, the payload is copied into the 
+ * caller's buffer, truncated to its size. A payload 
+ * overwritten by a later broadcast before the caller 
+ * reads it is lost: the caller was released all the 
+ * same, and gets -2 with errno EAGAIN.
+ * 
+ * @param lgroup, previously installed
+ * @param barrier, id < LGROUP_BARRIERS
+ * @param payload, buffer of *size bytes
+ * @param size, in: buffer size, out: payload size (0: none)
+ * @return 
+ *		LGROUP_BARRIER_SERIAL_THREAD: success, caller released the barrier
+ *		0: success
+ *		-1: group is not installed
+ *		-2: sleep fail, check errno (EAGAIN: released, payload lost)
+ */
+int sleep_on_barrier_payload(struct lgroup_t *lgroup, unsigned int barrier,
+		void *payload, unsigned int *size);
+
+// sleep_on_barrier_timed flag: timeout is a CLOCK_MONOTONIC deadline
+#define LGROUP_ABSTIME 1
+
+/**
+ * Goes to sleep on a group's barrier, for at most timeout.
+ * 
+ * Same as sleep_on_barrier_id, but gives up when timeout 
+ * expires: the caller then leaves the barrier, as if it 
+ * never arrived.
+ * 
+ * @param lgroup, previously installed
+ * @param barrier, id < LGROUP_BARRIERS
+ * @param timeout, relative or, with LGROUP_ABSTIME, deadline
+ * @param flags, 0 or LGROUP_ABSTIME
+ * @return 
+ *		LGROUP_BARRIER_SERIAL_THREAD: success, caller released the barrier
+ *		0: success
+ *		-1: group is not installed
+ *		-2: sleep fail, check errno
+ *		-3: timeout expired
+ */
+int sleep_on_barrier_timed(struct lgroup_t *lgroup, unsigned int barrier,
+		const struct timespec *timeout, int flags);
+
+/**
+ * Awakes the group's barrier 0.
+ * 
+ * No syscall is issued if no one is sleeping in kernel.
  * 
  * @param lgroup, previously installed
  * @return
- *		2: no one is sleeping, alarm is not set
- *		1: alarm was already on
- *		0: alarm is set
+ *		2: no one is sleeping, barrier is not released
+ *		0: sleepers are released
  *		-1: group is not installed
  *		-2: ioctl fail, check errno
  */
 int awake_barrier(struct lgroup_t *lgroup);
 
+/**
+ * Awakes one of the group's barriers.
+ * 
+ * @param lgroup, previously installed
+ * @param barrier, id < LGROUP_BARRIERS
+ * @return
+ *		2: no one is sleeping, barrier is not released
+ *		0: sleepers are released
+ *		-1: group is not installed
+ *		-2: ioctl fail, check errno
+ */
+int awake_barrier_id(struct lgroup_t *lgroup, unsigned int barrier);
+
+/**
+ * Awakes one of the group's barriers, broadcasting a payload.
+ * 
+ * Each released sleep_on_barrier_payload caller gets a 
+ * copy of payload, in a single syscall of the awaker.
+ * 
+ * @param lgroup, previously installed
+ * @param barrier, id < LGROUP_BARRIERS
+ * @param payload
+ * @param size, up to LGROUP_BARRIER_PAYLOAD_MAX
+ * @return
+ *		2: no one is sleeping, barrier is not released
+ *		0: sleepers are released
+ *		-1: group is not installed
+ *		-2: ioctl fail, check errno
+ */
+int awake_barrier_payload(struct lgroup_t *lgroup, unsigned int barrier,
+		const void *payload, unsigned int size);
+
+/**
+ * Sets the amount of parties of one of the group's barriers.
+ * 
+ * With parties > 0, the barrier releases itself when 
+ * the parties-th thread goes to sleep on it, no 
+ * awaker is needed. 0 restores the awaker-driven barrier.
+ * 
+ * @param lgroup, previously installed
+ * @param barrier, id < LGROUP_BARRIERS
+ * @param parties
+ * @return
+ *		LGROUP_BARRIER_SERIAL_THREAD: set, waiting sleepers were released
+ *		0: success
+ *		-1: group is not installed
+ *		-2: ioctl fail, check errno
+ */
+int set_barrier_parties(struct lgroup_t *lgroup, unsigned int barrier, unsigned int parties);
+
+// set_barrier_mode modes
+#define LGROUP_BARRIER_FLAT 0  // the releaser wakes all sleepers up
+#define LGROUP_BARRIER_TREE 1  // sleepers grouped by NUMA node wake each other up
+
+/**
+ * Sets the wake-up mode of one of the group's barriers.
+ * 
+ * In LGROUP_BARRIER_TREE mode, sleepers are partitioned 
+ * per NUMA node and released sleepers wake the others 
+ * up in a tree-like fashion: it scales better than the 
+ * flat mode for hundreds of sleepers. Switch modes while 
+ * no one is sleeping on the barrier.
+ * 
+ * @param lgroup, previously installed
+ * @param barrier, id < LGROUP_BARRIERS
+ * @param mode, LGROUP_BARRIER_FLAT or LGROUP_BARRIER_TREE
+ * @return
+ *		0: success
+ *		-1: group is not installed
+ *		-2: ioctl fail, check errno
+ */
+int set_barrier_mode(struct lgroup_t *lgroup, unsigned int barrier, unsigned int mode);
+
 
 // --------------  CONTROL OPERATIONS -------------- //
 
@@ -122,20 +465,104 @@ int awake_barrier(struct lgroup_t *lgroup);
 int install_group(struct lgroup_t *group, char *group_id);
 
 /**
- * Reads current group's max_message_size.
+ * Installs many groups into the system at once.
+ * 
+ * Same as install_group on each lgroups[i] and group_ids[i], 
+ * in a single syscall.
+ * On failure, the groups resolved before it are installed.
+ * 
+ * @param lgroups, previously initialized
+ * @param group_ids
+ * @param count, up to 65536
+ * @return
+ *		amount of groups installed by the call
+ *		-1: module not installed
+ *		-2: groups resource unavailable
+ *		-3: INSTALL_GROUPS ioctl failed, check errno
+ */
+int install_groups(struct lgroup_t **lgroups, char **group_ids, unsigned int count);
+
+/**
+ * Uninstalls the group from the system.
+ * 
+ * Its id can then be installed anew as a different group. 
+ * Members still holding it, this lgroup included, keep 
+ * using it until they finalize their lgroups.
+ * 
+ * @param lgroup, previously installed
+ * @return
+ *		0: group is uninstalled
+ *		-1: group is not installed
+ *		-2: UNINSTALL_GROUP ioctl failed, check errno
+ *		-3: group was already uninstalled
+ */
+int uninstall_group(struct lgroup_t *lgroup);
+
+/**
+ * Creates the group's /dev node and sysfs attributes.
+ * 
+ * Groups are reachable through their lgroup only, until 
+ * exported: by this call, sysfs fallbacks of the operations 
+ * below, or an install by path. Exporting twice is harmless.
+ * 
+ * @param lgroup, previously installed
+ * @return
+ *		0: group is exported
+ *		-1: group is not installed
+ *		-2: EXPORT_GROUP ioctl failed, check errno
+ */
+int export_group(struct lgroup_t *lgroup);
+
+// group parameters, read and written at once
+struct lgroup_config_t {
+	unsigned long max_message_size;
+	unsigned long max_storage_size;
+	unsigned int delay;  // ms, as set_send_delay
+	unsigned long size;  // read only: bytes of stored messages
+};
+
+/**
+ * Reads all of the group's parameters at once.
+ * 
+ * @param lgroup, previously installed
+ * @param config
+ * @return 
+ *		0: success
+ *		-1: group is not installed
+ *		-2: GET_CONFIG ioctl failed, check errno
+ */
+int get_group_config(struct lgroup_t *lgroup, struct lgroup_config_t *config);
+
+/**
+ * Writes all of the group's parameters at once. 
+ * Size limits require superuser privileges.
+ * 
+ * @param lgroup, previously installed
+ * @param config, size is ignored
+ * @return 
+ *		0: success
+ *		-1: group is not installed
+ *		-2: SET_CONFIG ioctl failed, check errno
+ */
+int set_group_config(struct lgroup_t *lgroup, const struct lgroup_config_t *config);
+
+/**
+ * Reads current group's max_message_size, 
+ * through sysfs on modules lacking GET_CONFIG.
  * 
  * @param lgroup, previously installed
  * @param size
  * @return 
  *		0: success
  *		-1: group is not installed
- *		-2: sysfs open fail
+ *		-2: GET_CONFIG ioctl or sysfs open fail
  *		-3: sysfs read fail
  */
 int get_max_message_size(struct lgroup_t *lgroup, unsigned long *size);
 
 /**
- * Writes the current group's max_message_size.
+ * Writes the current group's max_message_size, 
+ * through sysfs on modules lacking SET_CONFIG.
  * 
  * @param lgroup, previously installed
  * @param size
@@ -144,25 +571,27 @@ int get_max_message_size(struct lgroup_t *lgroup, unsigned long *size);
  *		-1: missing superuser privileges
  *		-2: group is not installed
  *		-3: sysfs open fail
- *		-4: sysfs write fail
+ *		-4: SET_CONFIG ioctl or sysfs write fail
  */
 int set_max_message_size(struct lgroup_t *lgroup, unsigned long size);
 
 /**
- * Reads current group's max_storage_size.
+ * Reads current group's max_storage_size, 
+ * through sysfs on modules lacking GET_CONFIG.
  * 
  * @param lgroup, previously installed
  * @param size
  * @return 
  *		0: success
  *		-1: group is not installed
- *		-2: sysfs open fail
+ *		-2: GET_CONFIG ioctl or sysfs open fail
  *		-3: sysfs read fail
  */
 int get_max_storage_size(struct lgroup_t *lgroup, unsigned long *size);
 
 /**
- * Writes the current group's max_storage_size.
+ * Writes the current group's max_storage_size, 
+ * through sysfs on modules lacking SET_CONFIG.
  * 
  * @param lgroup, previously installed
  * @param size
@@ -171,8 +600,169 @@ int get_max_storage_size(struct lgroup_t *lgroup, unsigned long *size);
  *		-1: missing superuser privileges
  *		-2: group is not installed
  *		-3: sysfs open fail
- *		-4: sysfs write fail
+ *		-4: SET_CONFIG ioctl or sysfs write fail
  */
 int set_max_storage_size(struct lgroup_t *lgroup, unsigned long size);
 
+// group counters since installation, as GET_STATS
+struct lgroup_stats_t {
+	unsigned long long msgs_written;
+	unsigned long long bytes_written;
+	unsigned long long msgs_read;
+	unsigned long long bytes_read;
+	unsigned long long msgs_delayed;
+	unsigned long long msgs_revoked;
+	unsigned long long msgs_flushed;
+	unsigned long long rejected_nospc;  // publications exceeding max_storage_size
+	unsigned long long rejected_msgsize;  // publications exceeding max_message_size
+	unsigned long long barrier_sleeps;
+	unsigned long long barrier_wakeups;
+	unsigned long size;  // bytes of stored messages
+	unsigned long peak_size;
+};
+
+/**
+ * Reads the group's runtime statistics. Counters are 
+ * kept per CPU in the module, they are not read at once.
+ * 
+ * @param lgroup, previously installed
+ * @param stats
+ * @return 
+ *		0: success
+ *		-1: group is not installed
+ *		-2: GET_STATS ioctl failed, check errno
+ */
+int get_group_stats(struct lgroup_t *lgroup, struct lgroup_stats_t *stats);
+
+// live group counters, as the group's status page
+struct lgroup_status_t {
+	unsigned long long published;  // messages made readable so far
+	unsigned long long delivered;  // messages dequeued so far
+	unsigned long long queued;  // readable messages
+	unsigned long long size;  // bytes of stored messages, delayed ones included
+	unsigned long long delayed;  // messages waiting for their delay
+	unsigned long long sleepers;  // threads sleeping on barriers or for messages
+};
+
+/**
+ * Reads the group's status from a read-only page shared 
+ * with the module, without system calls once mapped: 
+ * cheap enough for monitors polling many groups.
+ * 
+ * @param lgroup, previously installed
+ * @param status
+ * @return 
+ *		0: success
+ *		-1: group is not installed
+ *		-2: status page unavailable (ENODEV)
+ */
+int get_group_status(struct lgroup_t *lgroup, struct lgroup_status_t *status);
+
+
+// --------------  ASYNCHRONOUS OPERATIONS -------------- //
+
+struct lgroup_async_t;
+
+// asynchronous operations
+#define LGROUP_ASYNC_PUBLISH 0
+#define LGROUP_ASYNC_DELIVER 1
+#define LGROUP_ASYNC_BARRIER 2
+
+// outcome of an asynchronous operation
+struct lgroup_completion_t {
+	struct lgroup_t *lgroup;
+	int op;  // LGROUP_ASYNC_*
+	int res;  // as returned by the synchronous operation
+	int err;  // errno, if res < 0
+	void *buf;  // message, as submitted
+	unsigned long size;
+	unsigned int barrier;
+	void *user_data;
+};
+
+typedef void (*lgroup_callback_t)(struct lgroup_completion_t *completion);
+
+/**
+ * Starts a pool of threads running asynchronous operations.
+ * 
+ * Operations are run in submission order by the first 
+ * idle thread, none of them blocks it: barrier sleeps 
+ * arrive and deliveries finding no message are parked, 
+ * then one thread at a time polls their groups until 
+ * a barrier is released or a message is queued, so any 
+ * amount of them can wait on a few threads. 
+ * Completions are passed to the operation's callback, on 
+ * the thread that ran it, or else queued to be reaped 
+ * through async_reap.
+ * 
+ * @param threads, at least 1
+ * @return lgroup_async_t*, NULL on failure
+ */
+struct lgroup_async_t* lgroup_async_init(unsigned int threads);
+
+/**
+ * Runs the operations still submitted, then stops the pool.
+ * Barrier sleeps not released yet leave their barrier and 
+ * deliveries still waiting give up, completing with -2 
+ * (ECANCELED). Unreaped completions are discarded.
+ * 
+ * @param async
+ */
+void lgroup_async_destroy(struct lgroup_async_t *async);
+
+/**
+ * Posts a message of size bytes to the group-shared queue, 
+ * as publish_message would. msg must stay valid until completion.
+ * 
+ * @param async
+ * @param lgroup, previously installed
+ * @param msg
+ * @param size
+ * @param callback, NULL: completion is reaped
+ * @param user_data, handed back by the completion
+ * @return 
+ *		0: submitted
+ *		-1: out of memory
+ *		-2: pool is being destroyed
+ */
+int async_publish(struct lgroup_async_t *async, struct lgroup_t *lgroup, 
+		const void *msg, unsigned long size, lgroup_callback_t callback, void *user_data);
+
+/**
+ * Delivers a message from the group-shared queue into buf, 
+ * as deliver_message would, waiting for one if the queue 
+ * is empty. Consumers racing for it may take it first, 
+ * the delivery then waits for the next one.
+ * 
+ * Parameters and return values as async_publish.
+ */
+int async_deliver(struct lgroup_async_t *async, struct lgroup_t *lgroup, 
+		char *buf, unsigned long size, lgroup_callback_t callback, void *user_data);
+
+/**
+ * Goes to sleep on one of the group's barriers, 
+ * as sleep_on_barrier_id would.
+ * 
+ * Parameters and return values as async_publish.
+ */
+int async_sleep_on_barrier(struct lgroup_async_t *async, struct lgroup_t *lgroup, 
+		unsigned int barrier, lgroup_callback_t callback, void *user_data);
+
+/**
+ * Reaps queued completions, oldest first.
+ * 
+ * @param async
+ * @param completions, room for max of them
+ * @param max
+ * @param wait, non-zero: blocks until one is queued, 
+ *		unless no operation is in flight
+ * @return amount of completions reaped
+ */
+int async_reap(struct lgroup_async_t *async, struct lgroup_completion_t *completions, 
+		unsigned int max, int wait);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* lgroups.h */
@@ -0,0 +1,234 @@
+
+#ifndef	_LGROUPS_HPP
+#define	_LGROUPS_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lgroups.h"
+
+
+namespace lgroups {
+
+/**
+ * Types sent as their object representation, with no
+ * serialisation step: the kernel rejects single byte messages.
+ * Pointers and byte views refer to data elsewhere, so they aren't.
+ */
+template<typename T>
+concept Message = std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> && (sizeof(T) > 1)
+		&& !std::is_convertible_v<T, std::span<const std::byte>>;
+
+// errno of a failed lgroups call
+[[noreturn]] inline void throw_errno(const char *what)
+{
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+/**
+ * An installed group, owning its lgroup and descriptor.
+ *
+ * Move-only: the descriptor is closed when the owning
+ * Group is destroyed. Failures throw std::system_error,
+ * so do operations on default-constructed or moved-from
+ * Groups (EBADF).
+ */
+class Group
+{
+public:
+	Group() = default;
+
+	/**
+	 * Installs the group, or joins it if already installed.
+	 *
+	 * @param id, up to 32 characters
+	 */
+	explicit Group(const std::string &id) : lgroup_(lgroup_init())
+	{
+		int res;
+
+		if(!lgroup_)
+			throw std::bad_alloc();
+		if((res = install_group(lgroup_, const_cast<char*>(id.c_str()))) < 0)
+		{
+			int err = errno;
+			lgroup_destroy(lgroup_);
+			errno = err;
+			throw_errno("lgroups::Group: install_group");
+		}
+		installed_ = res == 1;
+	}
+
+	Group(const Group&) = delete;
+	Group& operator=(const Group&) = delete;
+
+	Group(Group &&other) noexcept
+		: lgroup_(std::exchange(other.lgroup_, nullptr)), installed_(other.installed_) {}
+
+	Group& operator=(Group &&other) noexcept
+	{
+		if(this != &other)
+		{
+			lgroup_destroy(lgroup_);
+			lgroup_ = std::exchange(other.lgroup_, nullptr);
+			installed_ = other.installed_;
+		}
+		return *this;
+	}
+
+	~Group()
+	{
+		lgroup_destroy(lgroup_);
+	}
+
+	explicit operator bool() const noexcept { return lgroup_; }
+
+	// whether constructing this Group installed the group
+	bool newly_installed() const noexcept { return installed_; }
+
+	// for the rest of the C API
+	struct lgroup_t* native_handle() const noexcept { return lgroup_; }
+
+	/**
+	 * Posts msg to the group-shared queue.
+	 *
+	 * @param msg, at least 2 bytes
+	 * @return amount of bytes written
+	 */
+	std::size_t publish(std::span<const std::byte> msg)
+	{
+		int res;
+
+		if((res = publish_message_n(handle("lgroups::Group::publish"), msg.data(), msg.size())) < 0)
+			throw_errno("lgroups::Group::publish");
+		return res;
+	}
+
+	template<Message T>
+	std::size_t publish(const T &msg)
+	{
+		return publish(std::as_bytes(std::span<const T, 1>(&msg, 1)));
+	}
+
+	/**
+	 * Delivers a message into buf, truncated to its size.
+	 *
+	 * @param buf
+	 * @return the filled part of buf, empty if no message is published
+	 */
+	std::span<std::byte> deliver(std::span<std::byte> buf)
+	{
+		int res;
+
+		if((res = deliver_message(handle("lgroups::Group::deliver"), 
+				reinterpret_cast<char*>(buf.data()), buf.size())) < 0)
+			throw_errno("lgroups::Group::deliver");
+		return buf.first(res);
+	}
+
+	/**
+	 * Delivers a message into msg.
+	 *
+	 * @param msg
+	 * @return false if no message is published
+	 */
+	template<Message T>
+	bool deliver(T &msg)
+	{
+		auto bytes = deliver(std::as_writable_bytes(std::span<T, 1>(&msg, 1)));
+
+		if(!bytes.empty() && bytes.size() != sizeof(T))
+		{
+			errno = EBADMSG;
+			throw_errno("lgroups::Group::deliver: message size");
+		}
+		return !bytes.empty();
+	}
+
+private:
+	friend class ReceiveBuffer;
+
+	// the lgroup, unless this Group owns none
+	struct lgroup_t* handle(const char *what) const
+	{
+		if(!lgroup_)
+		{
+			errno = EBADF;
+			throw_errno(what);
+		}
+		return lgroup_;
+	}
+
+	struct lgroup_t *lgroup_ = nullptr;
+	bool installed_ = false;
+};
+
+/**
+ * A receive buffer reused across deliveries.
+ *
+ * It grows to the largest message delivered, so that no
+ * message is truncated and calls don't allocate once it
+ * is large enough. Views are valid until the next delivery.
+ */
+class ReceiveBuffer
+{
+public:
+	explicit ReceiveBuffer(std::size_t capacity = 128) : buf_(capacity) {}
+
+	/**
+	 * Delivers a message from group.
+	 *
+	 * @param group
+	 * @return the message, empty if none is published
+	 */
+	std::span<const std::byte> deliver(Group &group)
+	{
+		struct lgroup_t *lgroup = group.handle("lgroups::ReceiveBuffer::deliver");
+		unsigned long needed;
+		int res;
+
+		// one syscall, unless the message is larger than any so far
+		for(;;)
+		{
+			if((res = deliver_message_fit(lgroup, buf_.data(), buf_.size(), &needed)) < 0)
+				throw_errno("lgroups::ReceiveBuffer::deliver");
+			if(!needed)
+				break;
+			buf_.resize(std::max<std::size_t>(needed, 2 * buf_.size()));
+		}
+		size_ = res;
+		return { buf_.data(), size_ };
+	}
+
+	/**
+	 * The last message delivered, viewed in place as a T.
+	 *
+	 * @return nullptr if its size isn't sizeof(T)
+	 */
+	template<Message T>
+	const T* as() const noexcept
+	{
+		static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+				"ReceiveBuffer storage is aligned as operator new");
+
+		return size_ == sizeof(T) ? std::launder(reinterpret_cast<const T*>(buf_.data())) : nullptr;
+	}
+
+	std::size_t capacity() const noexcept { return buf_.size(); }
+
+private:
+	std::vector<std::byte> buf_;
+	std::size_t size_ = 0;
+};
+
+} // namespace lgroups
+
+#endif /* lgroups.hpp */
@@ -15,8 +15,11 @@
 char *rand_string(size_t size);
 
 /**
- * Returns the number of the next available group
- * number in '/dev'
+ * Returns the number of the next available group, 
+ * probing the module through /dev/group0: a probe group 
+ * is installed and uninstalled, and minors are allocated 
+ * cyclically. Only valid if nobody else installs a group 
+ * before the caller does.
  * @return 
  */
 int next_group();
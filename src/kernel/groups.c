@@ -1,14 +1,32 @@
+#include <linux/anon_inodes.h>
 #include <linux/cdev.h>
+#include <linux/debugfs.h>
 #include <linux/fs.h>
-#include <linux/hashtable.h>
+#include <linux/idr.h>
+#include <linux/jump_label.h>
+#include <linux/kref.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/nodemask.h>
+#include <linux/parser.h>
+#include <linux/percpu.h>
+#include <linux/poll.h>
+#include <linux/rhashtable.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/uaccess.h>
+#include <linux/version.h>
 #include <linux/workqueue.h>
 #include <linux/xxhash.h>
 
 #include "groups.h"
 
+#define CREATE_TRACE_POINTS
+#include "groups_trace.h"
+
 
 // -------------- TYPES DEFINITION -------------- //
 
@@ -17,6 +35,7 @@ struct msg_t {
 	struct list_head node;  // node within gdev->published_list
 	char *text;
 	size_t size;
+	u64 stamp;  // ktime_get_ns() at write, if latency_hist
 };
 
 // delayed unit of information
@@ -25,11 +44,61 @@ struct delayed_msg_t {
 	struct list_head node;  // node within gdev->delayed_list
 	
 	struct msg_t *msg;  // the message to be published
+	unsigned int delay;  // ms, as requested
 	int is_revoked;
 	int is_flushed;
 	struct timer_list timer;  // linux kernel timer
 };
 
+// hierarchical barrier subgroup: sleepers of one NUMA node
+struct barrier_node_t {
+	atomic_t sleepers;
+	wait_queue_head_t sleeping_wq;  // exclusive waiters
+} ____cacheline_aligned_in_smp;
+
+// kernel side of a barrier, allocated on first sleep
+struct barrier_t {
+	struct barrier_shm_t *shm;  // state, within the group's barrier page
+	wait_queue_head_t sleeping_wq;
+	
+	int tree;  // hierarchical mode
+	struct barrier_node_t *nodes;  // nr_node_ids, allocated on first BARRIER_TREE
+};
+
+// per-CPU log-linear latency histogram: LAT_SUB buckets per power of two
+#define LAT_SUB_BITS 2
+#define LAT_SUB (1 << LAT_SUB_BITS)
+#define LAT_HIST_BUCKETS 160  // up to ~30 minutes, in ns
+struct lat_hist_t {
+	u32 buckets[LAT_HIST_BUCKETS];
+};
+
+// lock classes measured with lock_stats, per group ones first
+enum lock_class_t {
+	LOCK_PUBLISHED_LIST,
+	LOCK_SIZE,
+	LOCK_GROUP_CLASSES,
+	LOCK_PUBLISHED_WORK = LOCK_GROUP_CLASSES,
+	LOCK_INSTALL,
+	LOCK_CLASSES
+};
+
+// per-CPU wait and hold times of a lock class
+struct lock_stat_t {
+	u64 acquisitions;
+	u64 wait_ns;
+	u64 wait_max_ns;
+	u64 hold_ns;
+	u64 hold_max_ns;
+};
+
+// barrier payload slots, mapped from page 1 on
+#define BARRIER_PAYLOAD_BYTES PAGE_ALIGN(BARRIERS * sizeof(struct barrier_payload_t))
+#define BARRIER_PAYLOAD_PAGES (BARRIER_PAYLOAD_BYTES >> PAGE_SHIFT)
+
+// barrier page and payload slots, a single allocation
+#define BARRIER_PAGES_BYTES (PAGE_SIZE + BARRIER_PAYLOAD_BYTES)
+
 // kernel level representation of a group
 struct group_dev_t {
 
@@ -37,10 +106,21 @@ struct group_dev_t {
 	unsigned long size;  // of both published and delayed messages
 	unsigned long max_msg_size;
 	unsigned long max_strg_size;
+	unsigned long peak_size;
 	spinlock_t size_lock;
 	
+	struct group_stats_t __percpu *stats;  // counters only, see gdev_stats
+	struct lat_hist_t __percpu *read_lat;  // write to read, NULL unless latency_hist
+	struct lat_hist_t __percpu *delay_lat;  // timer publication past the delay
+	
+	// LOCK_GROUP_CLASSES entries, NULL unless lock_stats
+	struct lock_stat_t __percpu *lock_stats;
+	u64 published_locked_at;  // ns, by the published_list_lock holder
+	u64 size_locked_at;  // ns, by the size_lock holder
+	
 	struct list_head published_list;
 	spinlock_t published_list_lock;
+	wait_queue_head_t readers;  // READ_MESSAGES waiting for a message
 	
 	atomic_t delay;  // ms
 	
@@ -49,20 +129,55 @@ struct group_dev_t {
 
 	
 	// barrier information
-	int sleepers;
-	int wakeup;
-	spinlock_t barrier_lock;
-	wait_queue_head_t sleeping_wq;
+	struct barrier_shm_t *barrier_page;  // shared with userspace, on first barrier use
+	struct barrier_payload_t *barrier_payloads;  // shared, after the barrier page
+	spinlock_t payload_lock;  // serializes broadcasting releases
+	wait_queue_head_t pollers;  // poll() on watched barriers
+	
+	// status counters, mirrored into the status page once it is mapped
+	atomic64_t published, delivered, delayed, sleepers;
+	struct group_status_t *status_page;  // shared read-only, on first mmap
+	spinlock_t status_lock;  // status page writers
+	struct barrier_t *barriers[BARRIERS];
 	
 	
 	// device, group and sysfs information
+	int minor;
 	struct device* dev;
-	struct cdev cdev;
+	struct cdev *cdev;  // outlives gdev while its last file is released
+	int exported;  // device, cdev and sysfs attributes exist, on demand
+	int uninstalled;  // no longer exportable
+	struct mutex export_lock;
 	struct group_t *group;
-	struct hlist_node hnode;  // groups_htbl hnode
+	struct rhash_head hnode;  // groups_htbl hnode
+	
+	struct kref kref;  // installation and open files
+	struct rcu_head rcu;  // groups_htbl and minors readers
 	
 	struct kobj_attribute max_msg_size_attr;
 	struct kobj_attribute max_strg_size_attr;
+	struct kobj_attribute stats_attr;
+};
+
+// a registered consumer buffer
+struct group_buf_t {
+	void __user *addr;
+	unsigned long size;
+	unsigned int id;  // index at registration
+};
+
+// per open file information
+struct group_file_t {
+	struct group_dev_t *gdev;
+	
+	struct mutex bufs_lock;
+	struct group_buf_t *bufs;  // REGISTER_BUFFERS, by increasing size
+	unsigned int nbufs;
+	
+	// WATCH_BARRIER: poll() reports EPOLLPRI once a barrier leaves its generation
+	unsigned long watching[BITS_TO_LONGS(BARRIERS)];
+	unsigned int watched[BARRIERS];
+	spinlock_t watch_lock;  // watchers of the file
 };
 
 
@@ -81,6 +196,8 @@ ssize_t group_read(struct file *filp, char __user *buf, size_t count, loff_t *f_
 ssize_t group_write(struct file *filp, const char __user *buf, size_t count, loff_t *f_pos);
 long group_ioctl(struct file* filp, unsigned int cmd, unsigned long arg);
 int group_flush(struct file* filp, fl_owner_t id);
+int group_mmap(struct file *filp, struct vm_area_struct *vma);
+__poll_t group_poll(struct file *filp, poll_table *wait);
 
 struct file_operations group_fops = {
 	.owner = THIS_MODULE,
@@ -89,20 +206,150 @@ struct file_operations group_fops = {
 	.read = group_read,
 	.write = group_write,
 	.unlocked_ioctl = group_ioctl,
-	.flush = group_flush
+	.flush = group_flush,
+	.mmap = group_mmap,
+	.poll = group_poll
 };
 
 
 // ------------- GLOBAL VARIABLES -------------------- //
 
-DECLARE_HASHTABLE(groups_htbl, 8);  // hashtable for group_dev_t(s) management
-static spinlock_t htbl_lock;
+static struct rhashtable groups_htbl;  // group_dev_t(s) by group id, RCU readers
+static DEFINE_IDR(minors);  // group_dev_t(s) by minor
 
 static struct class *class = NULL;
 static int major;
-static unsigned long range = 2000;
+static unsigned int range = 1024;  // minors per chrdev region
+static unsigned int regions = 0;  // registered chrdev regions, on demand
 static unsigned long groups = 0;  // amount of currently active groups
-static spinlock_t install_lock;
+static DEFINE_MUTEX(install_lock);  // serializes installations
+
+/* Minors handed out at most (0: all of them), checked at installation: 
+ * lowering it bounds the device groups, minors given out are kept. */
+static unsigned int max_minors = MINORMASK + 1;
+module_param(max_minors, uint, 0644);
+
+static struct group_stats_t __percpu *module_stats;  // of every group ever installed
+static struct dentry *debugfs_dir;
+
+static u32 groups_hashfn(const void *data, u32 len, u32 seed)
+{
+	return xxh64(data, strnlen(data, len), seed);
+}
+
+static u32 groups_obj_hashfn(const void *data, u32 len, u32 seed)
+{
+	const struct group_dev_t *gdev = data;
+	
+	return groups_hashfn(gdev->group->id, len, seed);
+}
+
+static int groups_obj_cmpfn(struct rhashtable_compare_arg *arg, const void *obj)
+{
+	const struct group_dev_t *gdev = obj;
+	
+	return strncmp(gdev->group->id, arg->key, 32);
+}
+
+// group ids are keyed through gdev->group, the table grows and shrinks by itself
+static const struct rhashtable_params groups_params = {
+	.key_len = 32,
+	.head_offset = offsetof(struct group_dev_t, hnode),
+	.hashfn = groups_hashfn,
+	.obj_hashfn = groups_obj_hashfn,
+	.obj_cmpfn = groups_obj_cmpfn,
+	.automatic_shrinking = true
+};
+
+
+// ------------- LOCK INSTRUMENTATION -------------------- //
+
+/* A lockstat-less measure of the group locks: with lock_stats set at load, 
+ * acquisitions are timestamped before and after taking the lock, and again 
+ * at release. The static key keeps the disabled mode down to a nop per site. 
+ * Holders stash their acquisition time next to the lock, it is theirs only. 
+ * Maxima are per CPU and may lose a racing update from softirqs. 
+ * install_lock stands in for groups_htbl, whose bucket locks are internal. */
+static bool lock_stats = false;
+module_param(lock_stats, bool, 0444);
+
+static DEFINE_STATIC_KEY_FALSE(lock_stats_key);
+
+static struct lock_stat_t __percpu *module_lock_stats;  // LOCK_CLASSES entries
+static u64 published_work_locked_at;
+static u64 install_locked_at;
+static u64 lock_stats_since;  // ns, last reset
+static struct group_stats_t lock_stats_base;  // module_stats at last reset
+
+static const char *lock_class_names[LOCK_CLASSES] = {
+	[LOCK_PUBLISHED_LIST] = "published_list_lock",
+	[LOCK_SIZE] = "size_lock",
+	[LOCK_PUBLISHED_WORK] = "published_work_lock",
+	[LOCK_INSTALL] = "install_lock",
+};
+
+static void lock_stat_add(struct lock_stat_t __percpu *stats, int hold, u64 ns)
+{
+	if (hold)
+	{
+		this_cpu_add(stats->hold_ns, ns);
+		if (ns > this_cpu_read(stats->hold_max_ns))
+			this_cpu_write(stats->hold_max_ns, ns);
+	}
+	else
+	{
+		this_cpu_inc(stats->acquisitions);
+		this_cpu_add(stats->wait_ns, ns);
+		if (ns > this_cpu_read(stats->wait_max_ns))
+			this_cpu_write(stats->wait_max_ns, ns);
+	}
+}
+
+// accounts ns of waiting or holding class, to the group (if any) and the module
+static void lock_stat_account(struct lock_stat_t __percpu *gstats, int class, int hold, u64 ns)
+{
+	if (gstats)
+		lock_stat_add(gstats + class, hold, ns);
+	lock_stat_add(module_lock_stats + class, hold, ns);
+}
+
+#define lockstat_lock(lockfn, lock, at, gstats, class) do { \
+		if (static_branch_unlikely(&lock_stats_key)) \
+		{ \
+			u64 __start = ktime_get_ns(); \
+			lockfn(lock); \
+			(at) = ktime_get_ns(); \
+			lock_stat_account(gstats, class, 0, (at) - __start); \
+		} \
+		else \
+			lockfn(lock); \
+	} while (0)
+
+#define lockstat_unlock(unlockfn, lock, at, gstats, class) do { \
+		if (static_branch_unlikely(&lock_stats_key)) \
+			lock_stat_account(gstats, class, 1, ktime_get_ns() - (at)); \
+		unlockfn(lock); \
+	} while (0)
+
+#define gdev_lock_published(gdev) lockstat_lock(spin_lock_bh, &(gdev)->published_list_lock, \
+		(gdev)->published_locked_at, (gdev)->lock_stats, LOCK_PUBLISHED_LIST)
+#define gdev_unlock_published(gdev) lockstat_unlock(spin_unlock_bh, &(gdev)->published_list_lock, \
+		(gdev)->published_locked_at, (gdev)->lock_stats, LOCK_PUBLISHED_LIST)
+
+#define gdev_lock_size(gdev) lockstat_lock(spin_lock, &(gdev)->size_lock, \
+		(gdev)->size_locked_at, (gdev)->lock_stats, LOCK_SIZE)
+#define gdev_unlock_size(gdev) lockstat_unlock(spin_unlock, &(gdev)->size_lock, \
+		(gdev)->size_locked_at, (gdev)->lock_stats, LOCK_SIZE)
+
+#define lock_published_work() lockstat_lock(spin_lock_bh, &published_work_lock, \
+		published_work_locked_at, NULL, LOCK_PUBLISHED_WORK)
+#define unlock_published_work() lockstat_unlock(spin_unlock_bh, &published_work_lock, \
+		published_work_locked_at, NULL, LOCK_PUBLISHED_WORK)
+
+#define lock_install() lockstat_lock(mutex_lock, &install_lock, \
+		install_locked_at, NULL, LOCK_INSTALL)
+#define unlock_install() lockstat_unlock(mutex_unlock, &install_lock, \
+		install_locked_at, NULL, LOCK_INSTALL)
 
 
 // ------------- GARBAGE COLLECTOR -------------------- //
@@ -129,9 +376,9 @@ static void published_work_fn(struct work_struct *work)
 	struct list_head *aux = next_published_list;
 	
 	// atomically swap active and next lists
-	spin_lock_bh(&published_work_lock);
+	lock_published_work();
 	next_published_list = active_published_list;
-	spin_unlock_bh(&published_work_lock);
+	unlock_published_work();
 	
 	active_published_list = aux;
 	
@@ -185,251 +432,1556 @@ static void delayed_work_fn(struct work_struct *work)
 }
 
 
-// ------------- SYSFS FUNCTIONS ----------------- //
+// ------------- STATISTICS ----------------- //
 
-ssize_t sysfs_show(struct kobject *kobj, struct kobj_attribute *attr, 
-		char *buf) {
-	int res = 0;
+/* Counters are per CPU, bumped without locks or shared cache lines on the 
+ * hot paths, and summed on read: they may be slightly off each other. 
+ * Each event counts for its group and for the module-wide aggregate. */
+#define gdev_stat_add(gdev, field, n) do { \
+		this_cpu_add((gdev)->stats->field, (n)); \
+		this_cpu_add(module_stats->field, (n)); \
+	} while (0)
+
+#define gdev_stat_inc(gdev, field) gdev_stat_add(gdev, field, 1)
+
+// sums per-CPU counters into stats, sizes are left untouched
+static void stats_sum(struct group_stats_t __percpu *pcpu, struct group_stats_t *stats)
+{
+	struct group_stats_t *s;
+	int cpu;
 	
-	if(!strcmp(attr->attr.name, "max_message_size"))
-	{
-		struct group_dev_t* gdev = container_of(attr, struct group_dev_t, max_msg_size_attr);
-		spin_lock(&gdev->size_lock);
-		res = sprintf(buf, "%lu", gdev->max_msg_size)+1;
-		spin_unlock(&gdev->size_lock);
-	}
-	else if(!strcmp(attr->attr.name, "max_storage_size"))
+	for_each_possible_cpu(cpu)
 	{
-		struct group_dev_t* gdev = container_of(attr, struct group_dev_t, max_strg_size_attr);
-		spin_lock(&gdev->size_lock);
-		res = sprintf(buf, "%lu", gdev->max_strg_size)+1;
-		spin_unlock(&gdev->size_lock);
+		s = per_cpu_ptr(pcpu, cpu);
+		stats->msgs_written += READ_ONCE(s->msgs_written);
+		stats->bytes_written += READ_ONCE(s->bytes_written);
+		stats->msgs_read += READ_ONCE(s->msgs_read);
+		stats->bytes_read += READ_ONCE(s->bytes_read);
+		stats->msgs_delayed += READ_ONCE(s->msgs_delayed);
+		stats->msgs_revoked += READ_ONCE(s->msgs_revoked);
+		stats->msgs_flushed += READ_ONCE(s->msgs_flushed);
+		stats->rejected_nospc += READ_ONCE(s->rejected_nospc);
+		stats->rejected_msgsize += READ_ONCE(s->rejected_msgsize);
+		stats->barrier_sleeps += READ_ONCE(s->barrier_sleeps);
+		stats->barrier_wakeups += READ_ONCE(s->barrier_wakeups);
 	}
+}
+
+// a snapshot of the group's counters and sizes
+static void gdev_stats(struct group_dev_t *gdev, struct group_stats_t *stats)
+{
+	memset(stats, 0, sizeof(struct group_stats_t));
+	stats_sum(gdev->stats, stats);
 	
-	return res;
+	gdev_lock_size(gdev);
+	stats->size = gdev->size;
+	stats->peak_size = gdev->peak_size;
+	gdev_unlock_size(gdev);
 }
 
-ssize_t sysfs_store(struct kobject *kobj, struct kobj_attribute *attr, 
-		const char *buf, size_t count) {
+// "name value" lines, as in /proc/vmstat
+static int stats_format(char *buf, size_t len, const struct group_stats_t *stats)
+{
+	return scnprintf(buf, len, 
+			"msgs_written %llu\nbytes_written %llu\n"
+			"msgs_read %llu\nbytes_read %llu\n"
+			"msgs_delayed %llu\nmsgs_revoked %llu\nmsgs_flushed %llu\n"
+			"rejected_nospc %llu\nrejected_msgsize %llu\n"
+			"barrier_sleeps %llu\nbarrier_wakeups %llu\n",
+			stats->msgs_written, stats->bytes_written, 
+			stats->msgs_read, stats->bytes_read, 
+			stats->msgs_delayed, stats->msgs_revoked, stats->msgs_flushed, 
+			stats->rejected_nospc, stats->rejected_msgsize, 
+			stats->barrier_sleeps, stats->barrier_wakeups);
+}
+
+// debugfs groups/stats: the module-wide aggregate
+static int module_stats_show(struct seq_file *m, void *v)
+{
+	struct group_stats_t stats;
+	char buf[512];
+	
+	memset(&stats, 0, sizeof(struct group_stats_t));
+	stats_sum(module_stats, &stats);
+	
+	seq_printf(m, "groups %lu\n", READ_ONCE(groups));
+	seq_write(m, buf, stats_format(buf, sizeof(buf), &stats));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(module_stats);
+
+/* Latency histograms cost 2 * LAT_HIST_BUCKETS counters per CPU and group, 
+ * so they are opt-in: groups installed while latency_hist is set get them. */
+static bool latency_hist = false;
+module_param(latency_hist, bool, 0644);
+
+// histogram bucket of ns: exact below LAT_SUB, then LAT_SUB per power of two
+static unsigned int lat_bucket(u64 ns)
+{
+	unsigned int msb;
+	
+	if (ns < LAT_SUB)
+		return ns;
+	msb = fls64(ns) - 1;
+	return min_t(unsigned int, LAT_HIST_BUCKETS - 1, ((msb - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + 
+			((ns >> (msb - LAT_SUB_BITS)) & (LAT_SUB - 1)));
+}
+
+// smallest ns of bucket idx
+static u64 lat_bucket_floor(unsigned int idx)
+{
+	if (idx < LAT_SUB)
+		return idx;
+	return (u64) (LAT_SUB + (idx & (LAT_SUB - 1))) << ((idx >> LAT_SUB_BITS) - 1);
+}
+
+static inline void lat_record(struct lat_hist_t __percpu *hist, u64 ns)
+{
+	this_cpu_inc(hist->buckets[lat_bucket(ns)]);
+}
+
+// zeroes hist, racing updates may survive
+static void lat_reset(struct lat_hist_t __percpu *hist)
+{
+	int cpu;
+	
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(hist, cpu), 0, sizeof(struct lat_hist_t));
+}
+
+// prints count and percentiles of hist, as upper bounds of their buckets
+static void lat_show(struct seq_file *m, const char *name, 
+		struct lat_hist_t __percpu *hist, u64 *sum)
+{
+	static const struct { unsigned int permille; const char *name; } pcts[] = {
+		{ 500, "p50" }, { 990, "p99" }, { 999, "p999" }
+	};
+	u64 total = 0, seen = 0;
+	unsigned int idx, p = 0;
+	int cpu;
 	
-	if(!strcmp(attr->attr.name, "max_message_size"))
+	memset(sum, 0, LAT_HIST_BUCKETS * sizeof(u64));
+	for_each_possible_cpu(cpu)
+		for (idx = 0; idx < LAT_HIST_BUCKETS; idx++)
+			sum[idx] += READ_ONCE(per_cpu_ptr(hist, cpu)->buckets[idx]);
+	for (idx = 0; idx < LAT_HIST_BUCKETS; idx++)
+		total += sum[idx];
+	
+	seq_printf(m, " %s_count=%llu", name, total);
+	for (idx = 0; idx < LAT_HIST_BUCKETS && p < ARRAY_SIZE(pcts) && total; idx++)
 	{
-		unsigned long tmp;
-		struct group_dev_t* gdev = container_of(attr, struct group_dev_t, max_msg_size_attr);
-		if(sscanf(buf, "%lu", &tmp))
-		{
-			spin_lock(&gdev->size_lock);
-			gdev->max_msg_size = tmp;
-			spin_unlock(&gdev->size_lock);
-		}
+		seen += sum[idx];
+		for (; p < ARRAY_SIZE(pcts) && seen * 1000 >= total * pcts[p].permille; p++)
+			seq_printf(m, " %s_%s=%llu", name, pcts[p].name, lat_bucket_floor(idx + 1));
 	}
-	else if(!strcmp(attr->attr.name, "max_storage_size"))
+}
+
+/* debugfs groups/latency: a line per group having histograms, in ns. 
+ * Writing a minor resets its histograms, writing -1 resets all of them. 
+ * Groupfs groups have no minor: they aren't listed. */
+static int latency_show(struct seq_file *m, void *v)
+{
+	struct group_dev_t *gdev;
+	u64 *sum;
+	int minor;
+	
+	if (!(sum = kmalloc_array(LAT_HIST_BUCKETS, sizeof(u64), GFP_KERNEL)))
+		return -ENOMEM;
+	
+	// group_dev_t(s) and their histograms are freed after a grace period
+	rcu_read_lock();
+	idr_for_each_entry(&minors, gdev, minor)
 	{
-		unsigned long tmp;
-		struct group_dev_t* gdev = container_of(attr, struct group_dev_t, max_strg_size_attr);
-		if(sscanf(buf, "%lu", &tmp))
-		{
-			spin_lock(&gdev->size_lock);
-			gdev->max_strg_size = tmp;
-			spin_unlock(&gdev->size_lock);
-		}
+		if (!gdev->read_lat)
+			continue;
+		seq_printf(m, "group%d", minor);
+		lat_show(m, "read", gdev->read_lat, sum);
+		lat_show(m, "delay_late", gdev->delay_lat, sum);
+		seq_putc(m, '\n');
 	}
+	rcu_read_unlock();
 	
-	return count;
+	kfree(sum);
+	return 0;
 }
 
+static int latency_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, latency_show, NULL);
+}
 
-// ------------- AUXILIARY FUNCTIONS ----------------- //
-
-static int gdev_init(struct group_dev_t** gdev_pp, struct group_t *group, dev_t dev, uint64_t hkey)
+static ssize_t latency_write(struct file *filp, const char __user *buf, 
+		size_t count, loff_t *f_pos)
 {
-	struct kobj_attribute msg_kobj_attr = __ATTR(max_message_size, S_IRUGO | S_IWUSR, sysfs_show, sysfs_store);
-	struct kobj_attribute strg_kobj_attr = __ATTR(max_storage_size, S_IRUGO | S_IWUSR, sysfs_show, sysfs_store);
-	char devname[32];
 	struct group_dev_t *gdev;
-	int err = 0;
+	int minor, target, err;
 	
-	// allocate new group_dev_t
-	if (!(gdev = kmem_cache_alloc(group_dev_cache, GFP_KERNEL)))
+	if ((err = kstrtoint_from_user(buf, count, 10, &target)))
+		return err;
+	
+	rcu_read_lock();
+	idr_for_each_entry(&minors, gdev, minor)
 	{
-		printk(KERN_ERR "%s/group%ld: could not initialize a new group_dev_t.\n", KBUILD_MODNAME, groups);
-		return -ENOMEM;
+		if (!gdev->read_lat || (target >= 0 && minor != target))
+			continue;
+		lat_reset(gdev->read_lat);
+		lat_reset(gdev->delay_lat);
 	}
-	memset(gdev, 0, sizeof(struct group_dev_t));
+	rcu_read_unlock();
+	
+	return count;
+}
 
-	// create struct device
-	snprintf(devname, 32, "group%ld", groups);
-	gdev->dev = device_create(class, NULL, dev, NULL, devname);
-	if (IS_ERR(gdev->dev))
-	{
-		err = PTR_ERR(gdev->dev);
-		printk(KERN_ERR "%s/group%ld: error creating device, major=%d, minor=%ld.\n",
-			KBUILD_MODNAME, groups, major, groups);
-		goto failed_devicecreate;
-	}
+static const struct file_operations latency_fops = {
+	.owner = THIS_MODULE,
+	.open = latency_open,
+	.read = seq_read,
+	.write = latency_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void lock_stats_show_class(struct seq_file *m, struct lock_stat_t __percpu *stats, int class)
+{
+	struct lock_stat_t sum = { 0 }, *s;
+	int cpu;
 	
-	// create new char device
-	cdev_init(&gdev->cdev, &group_fops);
-	gdev->cdev.owner = THIS_MODULE;
-	if ((err = cdev_add(&gdev->cdev, dev, 1)))
+	for_each_possible_cpu(cpu)
 	{
-		printk(KERN_ERR "%s/group%ld: error adding group_dev_t cdev.\n", KBUILD_MODNAME, groups);
-		goto failed_addcdev;
+		s = per_cpu_ptr(stats, cpu);
+		sum.acquisitions += READ_ONCE(s->acquisitions);
+		sum.wait_ns += READ_ONCE(s->wait_ns);
+		sum.wait_max_ns = max(sum.wait_max_ns, READ_ONCE(s->wait_max_ns));
+		sum.hold_ns += READ_ONCE(s->hold_ns);
+		sum.hold_max_ns = max(sum.hold_max_ns, READ_ONCE(s->hold_max_ns));
 	}
+	seq_printf(m, " %s acquisitions=%llu wait_ns=%llu wait_max_ns=%llu hold_ns=%llu hold_max_ns=%llu\n", 
+			lock_class_names[class], sum.acquisitions, sum.wait_ns, sum.wait_max_ns, 
+			sum.hold_ns, sum.hold_max_ns);
+}
+
+/* debugfs groups/locks: wait and hold times since the last reset, module-wide 
+ * then per group, along with the messages moved meanwhile. Any write resets. */
+static int lock_stats_show(struct seq_file *m, void *v)
+{
+	struct group_stats_t stats;
+	struct group_dev_t *gdev;
+	int minor, class;
 	
-	// expose sysfs attributes
-	gdev->max_msg_size_attr = msg_kobj_attr;
-	if ((err = sysfs_create_file(&gdev->dev->kobj, &gdev->max_msg_size_attr.attr))) 
+	if (!static_branch_unlikely(&lock_stats_key))
 	{
-		printk(KERN_ERR "%s/group%ld: error exposing max_message_size in sysfs.\n", KBUILD_MODNAME, groups);
-		goto failed_sysfs_msg;
+		seq_puts(m, "disabled, load with lock_stats=1\n");
+		return 0;
 	}
-	gdev->max_strg_size_attr = strg_kobj_attr;
-	if ((err = sysfs_create_file(&gdev->dev->kobj, &gdev->max_strg_size_attr.attr))) 
+	
+	memset(&stats, 0, sizeof(struct group_stats_t));
+	stats_sum(module_stats, &stats);
+	seq_printf(m, "interval_ns=%llu msgs_written=%llu msgs_read=%llu\n", 
+			ktime_get_ns() - READ_ONCE(lock_stats_since), 
+			stats.msgs_written - lock_stats_base.msgs_written, 
+			stats.msgs_read - lock_stats_base.msgs_read);
+	
+	seq_puts(m, "module\n");
+	for (class = 0; class < LOCK_CLASSES; class++)
+		lock_stats_show_class(m, module_lock_stats, class);
+	
+	// group_dev_t(s) and their stats are freed after a grace period
+	rcu_read_lock();
+	idr_for_each_entry(&minors, gdev, minor)
 	{
-		printk(KERN_ERR "%s/group%ld: error exposing max_storage_size in sysfs.\n", KBUILD_MODNAME, groups);
-		goto failed_sysfs_storage;
+		seq_printf(m, "group%d\n", minor);
+		for (class = 0; class < LOCK_GROUP_CLASSES; class++)
+			lock_stats_show_class(m, gdev->lock_stats, class);
 	}
+	rcu_read_unlock();
+	return 0;
+}
 
-	// initialize group_t
-	strncpy(group->devname, devname, 32);
-	gdev->group = group;
+static void lock_stats_reset(struct lock_stat_t __percpu *stats, int classes)
+{
+	int cpu;
+	
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(stats, cpu), 0, classes * sizeof(struct lock_stat_t));
+}
 
-	// initialize r/w parameters
-	spin_lock_init(&gdev->size_lock);
-	gdev->size = 0;
-	gdev->max_msg_size = 100;
-	gdev->max_strg_size = 10000;
+static int lock_stats_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, lock_stats_show, NULL);
+}
 
-	spin_lock_init(&gdev->published_list_lock);
-	INIT_LIST_HEAD(&gdev->published_list);
+static ssize_t lock_stats_write(struct file *filp, const char __user *buf, 
+		size_t count, loff_t *f_pos)
+{
+	struct group_dev_t *gdev;
+	int minor;
 	
-	// delayed write
-	atomic_set(&gdev->delay, 0);
+	if (!static_branch_unlikely(&lock_stats_key))
+		return -EOPNOTSUPP;
 	
-	spin_lock_init(&gdev->delayed_list_lock);
-	INIT_LIST_HEAD(&gdev->delayed_list);
-
-	// initialize barrier parameters
-	spin_lock_init(&gdev->barrier_lock);
-	gdev->sleepers = 0;
-	gdev->wakeup = 0;
-	init_waitqueue_head(&gdev->sleeping_wq);
+	// racing acquisitions may straddle the reset
+	lock_stats_reset(module_lock_stats, LOCK_CLASSES);
+	rcu_read_lock();
+	idr_for_each_entry(&minors, gdev, minor)
+		lock_stats_reset(gdev->lock_stats, LOCK_GROUP_CLASSES);
+	rcu_read_unlock();
 	
-	// atomically publish gdev into groups_htbl
-	spin_lock(&htbl_lock);
-	hash_add(groups_htbl, &gdev->hnode, hkey);
-	spin_unlock(&htbl_lock);
+	memset(&lock_stats_base, 0, sizeof(struct group_stats_t));
+	stats_sum(module_stats, &lock_stats_base);
+	WRITE_ONCE(lock_stats_since, ktime_get_ns());
+	return count;
+}
 
-	// propagate gdev address
-	if(gdev_pp) *gdev_pp = gdev;
+static const struct file_operations lock_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = lock_stats_open,
+	.read = seq_read,
+	.write = lock_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
 
-	// publish dev in kernel ring buffer
-	printk(KERN_INFO "%s: <id=%s>, device registered with major=%d, minor=%d.\n",
-		KBUILD_MODNAME, gdev->group->id, MAJOR(dev), MINOR(dev));
 
-	return 0;
+// ------------- STATUS PAGE ----------------- //
 
-failed_sysfs_storage:
-	sysfs_remove_file(&gdev->dev->kobj, &gdev->max_msg_size_attr.attr);
-failed_sysfs_msg:
-	cdev_del(&gdev->cdev);
-failed_addcdev:
-	device_destroy(class, dev);
-failed_devicecreate:
-	kmem_cache_free(group_dev_cache, gdev);
-	return err;
+// page offset of the status page within group mappings
+#define STATUS_PGOFF (1 + BARRIER_PAYLOAD_PAGES)
+
+/* Monitors sample the status page with plain loads, retrying while seq is 
+ * odd or moved meanwhile (a seqcount). Counters are kept as atomics, only 
+ * mapped groups allocate the page and take status_lock to rewrite it. 
+ * 
+ * Readers skip read(2) on empty queues checking ready alone: publications 
+ * count before being enqueued and deliveries after being dequeued, so ready 
+ * is never 0 while messages are queued. It is a plain word, not a futex 
+ * (pfn mappings can't back futexes): idle readers sleep in WAIT_MESSAGES. */
+static void status_publish(struct group_dev_t *gdev, struct group_status_t *page)
+{
+	struct group_status_t snapshot, *status = &snapshot;
+	
+	// deliveries first: a later published count keeps queued from underflowing
+	status->delivered = atomic64_read(&gdev->delivered);
+	smp_rmb();
+	status->published = atomic64_read(&gdev->published);
+	status->queued = status->published - status->delivered;
+	status->delayed = atomic64_read(&gdev->delayed);
+	status->sleepers = atomic64_read(&gdev->sleepers);
+	status->size = READ_ONCE(gdev->size);
+	
+	atomic_inc(&page->seq);
+	smp_wmb();
+	WRITE_ONCE(page->published, status->published);
+	WRITE_ONCE(page->delivered, status->delivered);
+	WRITE_ONCE(page->queued, status->queued);
+	WRITE_ONCE(page->size, status->size);
+	WRITE_ONCE(page->delayed, status->delayed);
+	WRITE_ONCE(page->sleepers, status->sleepers);
+	smp_wmb();
+	atomic_inc(&page->seq);
+	atomic_set(&page->ready, min_t(u64, status->queued, UINT_MAX));
 }
 
-void timer_callback(struct timer_list *t)
+// applies deltas to the group's status, the page is rewritten if mapped
+static void gdev_status_add(struct group_dev_t *gdev, int published, int delivered, 
+		int delayed, int sleepers)
 {
-	struct delayed_msg_t *delayed_msg = from_timer(delayed_msg, t, timer);
-	struct group_dev_t* gdev = delayed_msg->gdev;
+	struct group_status_t *page;
 	
-	// enqueue msg
-	spin_lock_bh(&gdev->published_list_lock);
-	list_add_tail(&delayed_msg->msg->node, &gdev->published_list);
-	spin_unlock_bh(&gdev->published_list_lock);
+	if (published)
+		atomic64_add(published, &gdev->published);
+	if (delivered)
+		atomic64_add(delivered, &gdev->delivered);
+	if (delayed)
+		atomic64_add(delayed, &gdev->delayed);
+	if (sleepers)
+		atomic64_add(sleepers, &gdev->sleepers);
+	
+	// pairs with gdev_status_page: either the page is seen or it has the deltas
+	smp_mb__after_atomic();
+	if ((page = READ_ONCE(gdev->status_page)))
+	{
+		spin_lock_bh(&gdev->status_lock);
+		status_publish(gdev, page);
+		spin_unlock_bh(&gdev->status_lock);
+	}
+}
 
-	// delete delayed_msg
-	spin_lock_bh(&gdev->delayed_list_lock);
-	// being flushed?
-	if(delayed_msg->is_flushed)
+// the status page, allocated and filled on first use
+static struct group_status_t* gdev_status_page(struct group_dev_t *gdev)
+{
+	struct group_status_t *page;
+	
+	if ((page = READ_ONCE(gdev->status_page)))
+		return page;
+	if (!(page = (struct group_status_t*) get_zeroed_page(GFP_KERNEL)))
+		return NULL;
+	
+	spin_lock_bh(&gdev->status_lock);
+	if (gdev->status_page)  // concurrent first mappings
 	{
-		// don't unlink nor deallocate the node, return
-		spin_unlock_bh(&gdev->delayed_list_lock);
-		return;
+		free_page((unsigned long) page);
+		page = gdev->status_page;
 	}
 	else
 	{
-		// unlink and deallocate
-		list_del(&delayed_msg->node);
-		spin_unlock_bh(&gdev->delayed_list_lock);
-
-		kmem_cache_free(delayed_msg_cache, delayed_msg);
+		WRITE_ONCE(gdev->status_page, page);
+		smp_mb();
+		status_publish(gdev, page);
 	}
+	spin_unlock_bh(&gdev->status_lock);
+	
+	return page;
 }
 
 
-// ------------- FILE OPERATIONS --------------------- //
+// ------------- SYSFS FUNCTIONS ----------------- //
 
-int group_open(struct inode *inode, struct file *filp)
-{
-	filp->private_data = container_of(inode->i_cdev, struct group_dev_t, cdev);
-	return 0;
+static ssize_t stats_show(struct kobject *kobj, struct kobj_attribute *attr, 
+		char *buf) {
+	struct group_dev_t* gdev = container_of(attr, struct group_dev_t, stats_attr);
+	struct group_stats_t stats;
+	int n;
+	
+	gdev_stats(gdev, &stats);
+	n = stats_format(buf, PAGE_SIZE, &stats);
+	return n + scnprintf(buf + n, PAGE_SIZE - n, "size %lu\npeak_size %lu\n", 
+			stats.size, stats.peak_size);
 }
 
-int group_release(struct inode *inode, struct file *filp)
-{
-	return 0;
+static ssize_t max_message_size_show(struct kobject *kobj, struct kobj_attribute *attr, 
+		char *buf) {
+	struct group_dev_t* gdev = container_of(attr, struct group_dev_t, max_msg_size_attr);
+	unsigned long val;
+	
+	gdev_lock_size(gdev);
+	val = gdev->max_msg_size;
+	gdev_unlock_size(gdev);
+	
+	return sprintf(buf, "%lu\n", val);
 }
 
-ssize_t group_read(struct file *filp, char __user *buf, size_t count,
-		loff_t *f_pos) {
-	struct group_dev_t *gdev = filp->private_data;
-	struct msg_t* msg;
-	size_t n;
+static ssize_t max_message_size_store(struct kobject *kobj, struct kobj_attribute *attr, 
+		const char *buf, size_t count) {
+	struct group_dev_t* gdev = container_of(attr, struct group_dev_t, max_msg_size_attr);
+	unsigned long val;
+	int err;
 	
-	// atomically dequeue message
-	spin_lock_bh(&gdev->published_list_lock);
-	if (list_empty(&gdev->published_list))
-	{
-		spin_unlock_bh(&gdev->published_list_lock);
-		return 0; // EOF
-	}
-	msg = list_first_entry(&gdev->published_list, struct msg_t, node);
-	list_del(&msg->node);
-	spin_unlock_bh(&gdev->published_list_lock);
+	if ((err = kstrtoul(buf, 10, &val)))
+		return err;
 	
-	// data transfers
-	n = min(msg->size, count);
-	if (copy_to_user(buf, msg->text, n))
-	{
-		// in case of errors, recover atomically re-enqueuing the message
-		spin_lock_bh(&gdev->published_list_lock);
-		list_add(&msg->node, &gdev->published_list);
-		spin_unlock_bh(&gdev->published_list_lock);
-		return -EFAULT;
-	}
+	gdev_lock_size(gdev);
+	gdev->max_msg_size = val;
+	gdev_unlock_size(gdev);
 	
-	// atomically decrease group size
-	spin_lock(&gdev->size_lock);
-	gdev->size -= msg->size;
-	spin_unlock(&gdev->size_lock);
+	return count;
+}
+
+static ssize_t max_storage_size_show(struct kobject *kobj, struct kobj_attribute *attr, 
+		char *buf) {
+	struct group_dev_t* gdev = container_of(attr, struct group_dev_t, max_strg_size_attr);
+	unsigned long val;
 	
-	// atomically defer deallocation
-	spin_lock_bh(&published_work_lock);
-	list_add_tail(&msg->node, next_published_list);
-	spin_unlock_bh(&published_work_lock);
+	gdev_lock_size(gdev);
+	val = gdev->max_strg_size;
+	gdev_unlock_size(gdev);
+	
+	return sprintf(buf, "%lu\n", val);
+}
+
+static ssize_t max_storage_size_store(struct kobject *kobj, struct kobj_attribute *attr, 
+		const char *buf, size_t count) {
+	struct group_dev_t* gdev = container_of(attr, struct group_dev_t, max_strg_size_attr);
+	unsigned long val;
+	int err;
+	
+	if ((err = kstrtoul(buf, 10, &val)))
+		return err;
+	
+	gdev_lock_size(gdev);
+	gdev->max_strg_size = val;
+	gdev_unlock_size(gdev);
+	
+	return count;
+}
+
+
+// ------------- AUXILIARY FUNCTIONS ----------------- //
+
+// registers chrdev regions up to minor, caller holds install_lock
+static int minor_region_get(int minor)
+{
+	int err;
+	
+	while (minor >= regions * range)
+	{
+		if ((err = register_chrdev_region(MKDEV(major, regions * range), range, KBUILD_MODNAME)))
+			return err;
+		regions++;
+	}
+	return 0;
+}
+
+/* allocates a group without a minor, reachable through its descriptors only: 
+ * gfp is GFP_KERNEL_ACCOUNT to charge it to the caller's memory cgroup */
+static int gdev_create(struct group_dev_t** gdev_pp, struct group_t *group, gfp_t gfp)
+{
+	struct group_dev_t *gdev;
+	int err = 0;
+	
+	// allocate new group_dev_t
+	if (!(gdev = kmem_cache_alloc(group_dev_cache, gfp)))
+	{
+		printk(KERN_ERR "%s: could not initialize a new group_dev_t.\n", KBUILD_MODNAME);
+		return -ENOMEM;
+	}
+	memset(gdev, 0, sizeof(struct group_dev_t));
+
+	// barrier pages are allocated on first barrier use
+	if (!(gdev->stats = alloc_percpu_gfp(struct group_stats_t, gfp)))
+	{
+		printk(KERN_ERR "%s: could not allocate the group stats.\n", KBUILD_MODNAME);
+		err = -ENOMEM;
+		goto failed_stats;
+	}
+	if (READ_ONCE(latency_hist) && (!(gdev->read_lat = alloc_percpu_gfp(struct lat_hist_t, gfp)) || 
+			!(gdev->delay_lat = alloc_percpu_gfp(struct lat_hist_t, gfp))))
+	{
+		printk(KERN_ERR "%s: could not allocate the latency histograms.\n", KBUILD_MODNAME);
+		err = -ENOMEM;
+		goto failed_lat;
+	}
+	if (lock_stats && !(gdev->lock_stats = __alloc_percpu_gfp(LOCK_GROUP_CLASSES * 
+			sizeof(struct lock_stat_t), __alignof__(struct lock_stat_t), gfp)))
+	{
+		printk(KERN_ERR "%s: could not allocate the lock stats.\n", KBUILD_MODNAME);
+		err = -ENOMEM;
+		goto failed_lock_stats;
+	}
+
+	// initialize group_t
+	gdev->group = group;
+	gdev->minor = -1;
+	mutex_init(&gdev->export_lock);
+
+	// initialize r/w parameters
+	spin_lock_init(&gdev->size_lock);
+	gdev->size = 0;
+	gdev->max_msg_size = 100;
+	gdev->max_strg_size = 10000;
+
+	spin_lock_init(&gdev->published_list_lock);
+	INIT_LIST_HEAD(&gdev->published_list);
+	init_waitqueue_head(&gdev->readers);
+	
+	// delayed write
+	atomic_set(&gdev->delay, 0);
+	
+	spin_lock_init(&gdev->delayed_list_lock);
+	INIT_LIST_HEAD(&gdev->delayed_list);
+
+	// barriers are zeroed once allocated, their kernel side on first sleep
+	spin_lock_init(&gdev->payload_lock);
+	init_waitqueue_head(&gdev->pollers);
+	spin_lock_init(&gdev->status_lock);
+	
+	// the installation reference, dropped by UNINSTALL_GROUP
+	kref_init(&gdev->kref);
+	
+	*gdev_pp = gdev;
+	return 0;
+
+failed_lock_stats:
+	free_percpu(gdev->delay_lat);
+failed_lat:
+	free_percpu(gdev->read_lat);
+	free_percpu(gdev->stats);
+failed_stats:
+	kmem_cache_free(group_dev_cache, gdev);
+	return err;
+}
+
+// frees a group that was never published, its group_t is left to the caller
+static void gdev_discard(struct group_dev_t *gdev)
+{
+	free_percpu(gdev->lock_stats);
+	free_percpu(gdev->delay_lat);
+	free_percpu(gdev->read_lat);
+	free_percpu(gdev->stats);
+	free_page((unsigned long) gdev->status_page);
+	if (gdev->barrier_page)
+		free_pages_exact(gdev->barrier_page, BARRIER_PAGES_BYTES);
+	if (gdev->minor >= 0)
+		idr_remove(&minors, gdev->minor);
+	kmem_cache_free(group_dev_cache, gdev);
+}
+
+// allocates a group, unreachable until published: caller holds install_lock
+static int gdev_alloc(struct group_dev_t** gdev_pp, struct group_t *group)
+{
+	struct group_dev_t *gdev;
+	unsigned int limit;
+	int minor, err;
+	
+	if ((err = gdev_create(&gdev, group, GFP_KERNEL)))
+		return err;
+	
+	// allocate a minor, recently released ones are reused last
+	limit = READ_ONCE(max_minors);
+	if (!limit || limit > MINORMASK + 1)
+		limit = MINORMASK + 1;
+	if ((minor = idr_alloc_cyclic(&minors, NULL, 0, limit, GFP_KERNEL)) < 0)
+	{
+		err = minor == -ENOSPC ? -EDQUOT : minor;
+		goto failed;
+	}
+	gdev->minor = minor;
+	if ((err = minor_region_get(minor)))
+	{
+		printk(KERN_ERR "%s/group%d: could not register its chrdev region.\n", KBUILD_MODNAME, minor);
+		goto failed;
+	}
+	snprintf(group->devname, sizeof(group->devname), "group%d", minor);
+	
+	*gdev_pp = gdev;
+	return 0;
+
+failed:
+	gdev_discard(gdev);
+	return err;
+}
+
+/* Creates the group's device, cdev and sysfs attributes. Groups are only 
+ * reachable through descriptors until their first path-based use: most of 
+ * them never need a /dev node, that would dominate install cost and memory. */
+static int gdev_export(struct group_dev_t *gdev)
+{
+	struct kobj_attribute msg_kobj_attr = __ATTR(max_message_size, S_IRUGO | S_IWUSR, 
+			max_message_size_show, max_message_size_store);
+	struct kobj_attribute strg_kobj_attr = __ATTR(max_storage_size, S_IRUGO | S_IWUSR, 
+			max_storage_size_show, max_storage_size_store);
+	struct kobj_attribute stats_kobj_attr = __ATTR(stats, S_IRUGO, stats_show, NULL);
+	dev_t dev = MKDEV(major, gdev->minor);
+	int err = 0;
+
+	// groupfs groups live in their mount only
+	if (gdev->minor < 0)
+		return -EOPNOTSUPP;
+
+	mutex_lock(&gdev->export_lock);
+	if (gdev->exported || gdev->uninstalled)
+	{
+		err = gdev->uninstalled ? -ENODEV : 0;
+		goto out;
+	}
+
+	// create struct device
+	gdev->dev = device_create(class, NULL, dev, NULL, gdev->group->devname);
+	if (IS_ERR(gdev->dev))
+	{
+		err = PTR_ERR(gdev->dev);
+		printk(KERN_ERR "%s/%s: error creating device, major=%d, minor=%d.\n",
+			KBUILD_MODNAME, gdev->group->devname, major, gdev->minor);
+		goto out;
+	}
+	
+	// create new char device
+	if (!(gdev->cdev = cdev_alloc()))
+	{
+		printk(KERN_ERR "%s/%s: could not allocate its cdev.\n", KBUILD_MODNAME, gdev->group->devname);
+		err = -ENOMEM;
+		goto failed_cdevalloc;
+	}
+	gdev->cdev->ops = &group_fops;
+	gdev->cdev->owner = THIS_MODULE;
+	if ((err = cdev_add(gdev->cdev, dev, 1)))
+	{
+		printk(KERN_ERR "%s/%s: error adding group_dev_t cdev.\n", KBUILD_MODNAME, gdev->group->devname);
+		goto failed_addcdev;
+	}
+	
+	// expose sysfs attributes
+	gdev->max_msg_size_attr = msg_kobj_attr;
+	if ((err = sysfs_create_file(&gdev->dev->kobj, &gdev->max_msg_size_attr.attr))) 
+	{
+		printk(KERN_ERR "%s/%s: error exposing max_message_size in sysfs.\n", KBUILD_MODNAME, gdev->group->devname);
+		goto failed_sysfs_msg;
+	}
+	gdev->max_strg_size_attr = strg_kobj_attr;
+	if ((err = sysfs_create_file(&gdev->dev->kobj, &gdev->max_strg_size_attr.attr))) 
+	{
+		printk(KERN_ERR "%s/%s: error exposing max_storage_size in sysfs.\n", KBUILD_MODNAME, gdev->group->devname);
+		goto failed_sysfs_storage;
+	}
+	gdev->stats_attr = stats_kobj_attr;
+	if ((err = sysfs_create_file(&gdev->dev->kobj, &gdev->stats_attr.attr))) 
+	{
+		printk(KERN_ERR "%s/%s: error exposing stats in sysfs.\n", KBUILD_MODNAME, gdev->group->devname);
+		goto failed_sysfs_stats;
+	}
+	
+	gdev->exported = 1;
+	goto out;
+
+failed_sysfs_stats:
+	sysfs_remove_file(&gdev->dev->kobj, &gdev->max_strg_size_attr.attr);
+failed_sysfs_storage:
+	sysfs_remove_file(&gdev->dev->kobj, &gdev->max_msg_size_attr.attr);
+failed_sysfs_msg:
+	cdev_del(gdev->cdev);
+	goto failed_cdevalloc;
+failed_addcdev:
+	kobject_put(&gdev->cdev->kobj);
+failed_cdevalloc:
+	device_destroy(class, dev);
+out:
+	mutex_unlock(&gdev->export_lock);
+	return err;
+}
+
+// removes the group's device, cdev and sysfs attributes for good, if any
+static void gdev_unexport(struct group_dev_t *gdev)
+{
+	mutex_lock(&gdev->export_lock);
+	gdev->uninstalled = 1;
+	if (gdev->exported)
+	{
+		sysfs_remove_file(&gdev->dev->kobj, &gdev->stats_attr.attr);
+		sysfs_remove_file(&gdev->dev->kobj, &gdev->max_strg_size_attr.attr);
+		sysfs_remove_file(&gdev->dev->kobj, &gdev->max_msg_size_attr.attr);
+		cdev_del(gdev->cdev);
+		device_destroy(class, MKDEV(major, gdev->minor));
+		gdev->exported = 0;
+	}
+	mutex_unlock(&gdev->export_lock);
+}
+
+// makes a group reachable by id and minor, caller holds install_lock
+static int gdev_publish(struct group_dev_t *gdev)
+{
+	int err;
+	
+	// readers may see it right away
+	if ((err = rhashtable_lookup_insert_key(&groups_htbl, gdev->group->id, &gdev->hnode, groups_params)))
+	{
+		printk(KERN_ERR "%s/%s: error publishing the group.\n", KBUILD_MODNAME, gdev->group->devname);
+		return err;
+	}
+	idr_replace(&minors, gdev, gdev->minor);
+	groups++;
+
+	// publish dev in kernel ring buffer
+	printk(KERN_INFO "%s: <id=%.32s>, device registered with major=%d, minor=%d.\n",
+		KBUILD_MODNAME, gdev->group->id, major, gdev->minor);
+	trace_group_install(gdev->group->id, gdev->minor);
+	return 0;
+}
+
+// installs a group, not exported yet: caller holds install_lock
+static int gdev_init(struct group_dev_t** gdev_pp, struct group_t *group)
+{
+	struct group_dev_t *gdev;
+	int err;
+	
+	if ((err = gdev_alloc(&gdev, group)))
+		return err;
+	if ((err = gdev_publish(gdev)))
+	{
+		gdev_discard(gdev);
+		return err;
+	}
+	
+	// propagate gdev address
+	if(gdev_pp) *gdev_pp = gdev;
+	return 0;
+}
+
+// group having id, caller holds rcu_read_lock
+static struct group_dev_t* gdev_lookup(const char *id)
+{
+	return rhashtable_lookup(&groups_htbl, id, groups_params);
+}
+
+// group having id, installed if missing: returned referenced
+static struct group_dev_t* gdev_install(const char *id, int *installed)
+{
+	struct group_t *k_group;
+	struct group_dev_t *gdev;
+	int err;
+	
+	*installed = 0;
+	
+	// first groups_htbl query, lockless
+	rcu_read_lock();
+	if ((gdev = gdev_lookup(id)) && !kref_get_unless_zero(&gdev->kref))
+		gdev = NULL;
+	rcu_read_unlock();
+	
+	if (gdev)
+		return gdev;
+	
+	// first query failed, group requires installation
+	lock_install();
+	
+	// second groups_htbl query, uninstalls hold install_lock as well
+	rcu_read_lock();
+	gdev = gdev_lookup(id);
+	rcu_read_unlock();
+	
+	if (!gdev)
+	{
+		if (!(k_group = kmalloc(sizeof(struct group_t), GFP_KERNEL)))
+		{
+			gdev = ERR_PTR(-ENOMEM);
+			goto out;
+		}
+		memcpy(k_group->id, id, 32);
+		
+		// second query failed -> installation
+		if ((err = gdev_init(&gdev, k_group)))
+		{
+			kfree(k_group);
+			gdev = ERR_PTR(err);
+			goto out;
+		}
+		*installed = 1;
+	}
+	kref_get(&gdev->kref);
+	
+out:
+	unlock_install();
+	return gdev;
+}
+
+/* Resolves count ids at once: existing groups in one lockless pass, missing 
+ * ones in a single install_lock section. 
+ * Resolved groups are returned referenced, NULL for the ones past an error. */
+static int gdev_install_batch(struct group_t *ids, struct group_dev_t **gdevs, 
+		unsigned int count, unsigned int *installed)
+{
+	struct group_t *k_group;
+	struct group_dev_t *gdev;
+	unsigned int i, missing = 0;
+	int err = 0;
+	
+	*installed = 0;
+	
+	rcu_read_lock();
+	for (i = 0; i < count; i++)
+	{
+		if ((gdevs[i] = gdev_lookup(ids[i].id)) && !kref_get_unless_zero(&gdevs[i]->kref))
+			gdevs[i] = NULL;
+		missing += !gdevs[i];
+	}
+	rcu_read_unlock();
+	
+	if (!missing)
+		return 0;
+	
+	lock_install();
+	for (i = 0; i < count; i++)
+	{
+		if (gdevs[i])
+			continue;
+		
+		// installed meanwhile, possibly earlier in the batch
+		rcu_read_lock();
+		gdev = gdev_lookup(ids[i].id);
+		rcu_read_unlock();
+		
+		if (!gdev)
+		{
+			if (!(k_group = kmalloc(sizeof(struct group_t), GFP_KERNEL)))
+			{
+				err = -ENOMEM;
+				break;
+			}
+			memcpy(k_group->id, ids[i].id, 32);
+			
+			if ((err = gdev_init(&gdev, k_group)))
+			{
+				kfree(k_group);
+				break;
+			}
+			(*installed)++;
+		}
+		kref_get(&gdev->kref);
+		gdevs[i] = gdev;
+	}
+	unlock_install();
+	
+	return err;
+}
+
+// makes a group unreachable by path and minor, caller holds install_lock
+static void gdev_unregister(struct group_dev_t *gdev)
+{
+	// EXPORT_GROUP doesn't take install_lock
+	gdev_unexport(gdev);
+	idr_remove(&minors, gdev->minor);
+	groups--;
+}
+
+static void gdev_free_rcu(struct rcu_head *rcu)
+{
+	struct group_dev_t *gdev = container_of(rcu, struct group_dev_t, rcu);
+	
+	free_percpu(gdev->lock_stats);
+	free_percpu(gdev->delay_lat);
+	free_percpu(gdev->read_lat);
+	free_percpu(gdev->stats);
+	kfree(gdev->group);  // hashed and compared by lockless lookups too
+	kmem_cache_free(group_dev_cache, gdev);
+}
+
+// releases all of a group's resources, it must be unlinked and closed
+static void gdev_free(struct group_dev_t *gdev)
+{
+	int id;
+	
+	// unread messages, deallocation deferred in bulk
+	// (delayed messages were flushed on last close syscall)
+	lock_published_work();
+	list_splice_tail_init(&gdev->published_list, next_published_list);
+	unlock_published_work();
+	queue_work(groups_wq, &published_work);
+	
+	for(id = 0; id < BARRIERS; id++)
+	{
+		if(gdev->barriers[id])
+			kfree(gdev->barriers[id]->nodes);
+		kfree(gdev->barriers[id]);
+	}
+	free_page((unsigned long) gdev->status_page);
+	if (gdev->barrier_page)
+		free_pages_exact(gdev->barrier_page, BARRIER_PAGES_BYTES);
+	
+	// lockless lookups may still be reading it
+	call_rcu(&gdev->rcu, gdev_free_rcu);
+}
+
+static void gdev_release(struct kref *kref)
+{
+	gdev_free(container_of(kref, struct group_dev_t, kref));
+}
+
+// module unload, no group can be open
+static void gdev_destroy_fn(void *ptr, void *arg)
+{
+	struct group_dev_t *gdev = ptr;
+	
+	gdev_unregister(gdev);
+	gdev_free(gdev);
+}
+
+static inline struct group_dev_t* file_gdev(struct file *filp)
+{
+	return ((struct group_file_t*) filp->private_data)->gdev;
+}
+
+static struct group_file_t* gfile_alloc(struct group_dev_t *gdev)
+{
+	struct group_file_t *gfile;
+	
+	if (!(gfile = kzalloc(sizeof(struct group_file_t), GFP_KERNEL)))
+		return NULL;
+	gfile->gdev = gdev;
+	mutex_init(&gfile->bufs_lock);
+	spin_lock_init(&gfile->watch_lock);
+	return gfile;
+}
+
+// opens a group file, taking the caller's reference over
+static int gfile_open(struct file *filp, struct group_dev_t *gdev)
+{
+	if (!(filp->private_data = gfile_alloc(gdev)))
+	{
+		kref_put(&gdev->kref, gdev_release);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+// registered buffers by increasing size, then id: sort() isn't stable
+static int group_buf_cmp(const void *a, const void *b)
+{
+	const struct group_buf_t *x = a, *y = b;
+	
+	if (x->size != y->size)
+		return x->size < y->size ? -1 : 1;
+	return x->id < y->id ? -1 : x->id > y->id;
+}
+
+// a new descriptor of the group, it inherits the caller's reference on success
+static int gfile_getfd(struct group_dev_t *gdev)
+{
+	struct group_file_t *gfile;
+	int fd;
+	
+	if (!(gfile = gfile_alloc(gdev)))
+		return -ENOMEM;
+	if ((fd = anon_inode_getfd("group", &group_fops, gfile, O_RDWR)) < 0)
+		kfree(gfile);
+	return fd;
+}
+
+// a new file of the group, not installed yet: it inherits the caller's reference on success
+static struct file* gfile_getfile(struct group_dev_t *gdev)
+{
+	struct group_file_t *gfile;
+	struct file *file;
+	
+	if (!(gfile = gfile_alloc(gdev)))
+		return ERR_PTR(-ENOMEM);
+	if (IS_ERR(file = anon_inode_getfile("group", &group_fops, gfile, O_RDWR)))
+		kfree(gfile);
+	return file;
+}
+
+void timer_callback(struct timer_list *t)
+{
+	struct delayed_msg_t *delayed_msg = from_timer(delayed_msg, t, timer);
+	struct group_dev_t* gdev = delayed_msg->gdev;
+	
+	trace_group_timer_publish(gdev->minor, delayed_msg->msg->size, READ_ONCE(gdev->size));
+	
+	// jiffies resolution: late by up to a tick, even on time
+	if (gdev->delay_lat)
+		lat_record(gdev->delay_lat, max_t(s64, 0, ktime_get_ns() - delayed_msg->msg->stamp - 
+				(u64) delayed_msg->delay * NSEC_PER_MSEC));
+	
+	// enqueue msg
+	gdev_status_add(gdev, 1, 0, -1, 0);
+	gdev_lock_published(gdev);
+	list_add_tail(&delayed_msg->msg->node, &gdev->published_list);
+	gdev_unlock_published(gdev);
+	wake_up_interruptible(&gdev->readers);
+
+	// delete delayed_msg
+	spin_lock_bh(&gdev->delayed_list_lock);
+	// being flushed?
+	if(delayed_msg->is_flushed)
+	{
+		// don't unlink nor deallocate the node, return
+		spin_unlock_bh(&gdev->delayed_list_lock);
+		return;
+	}
+	else
+	{
+		// unlink and deallocate
+		list_del(&delayed_msg->node);
+		spin_unlock_bh(&gdev->delayed_list_lock);
+
+		kmem_cache_free(delayed_msg_cache, delayed_msg);
+	}
+}
+
+
+// ------------- BARRIER FUNCTIONS ----------------- //
+
+// tree mode: sleepers woken by each released sleeper
+#define BARRIER_FANOUT 2
+
+// lockless payload reads attempted before taking payload_lock
+#define BARRIER_PAYLOAD_RETRIES 16
+
+/* Barrier state lives in a page shared with userspace, which can arrive, 
+ * spin and release on its own (see lgroups.c): kernel and userspace follow 
+ * the same protocol on the state word, so the fast path and the ioctls mix.
+ * Sleepers increase the sleepers word before checking the generation, 
+ * releasers bump the generation before checking the sleepers word: 
+ * either the sleeper sees the new generation or the releaser wakes it. */
+
+/* The barrier page and payloads, allocated on first barrier ioctl or mmap: 
+ * most groups never use barriers. The payloads are set before the page is 
+ * published, callers that got 0 can then access both with plain loads. */
+static int gdev_barrier_pages(struct group_dev_t *gdev)
+{
+	char *pages;
+	
+	if(smp_load_acquire(&gdev->barrier_page))
+		return 0;
+	if(!(pages = alloc_pages_exact(BARRIER_PAGES_BYTES, GFP_KERNEL | __GFP_ZERO)))
+		return -ENOMEM;
+	
+	spin_lock(&gdev->payload_lock);
+	if(gdev->barrier_page)  // concurrent first uses
+	{
+		spin_unlock(&gdev->payload_lock);
+		free_pages_exact(pages, BARRIER_PAGES_BYTES);
+		return 0;
+	}
+	gdev->barrier_payloads = (struct barrier_payload_t*) (pages + PAGE_SIZE);
+	smp_store_release(&gdev->barrier_page, (struct barrier_shm_t*) pages);
+	spin_unlock(&gdev->payload_lock);
+	
+	return 0;
+}
+
+// kernel side of barrier id, allocated if missing
+static struct barrier_t* barrier_get(struct group_dev_t *gdev, unsigned int id)
+{
+	struct barrier_t *barrier = READ_ONCE(gdev->barriers[id]), *old;
+	
+	if(barrier) return barrier;
+	
+	if(!(barrier = kmalloc(sizeof(struct barrier_t), GFP_KERNEL)))
+		return NULL;
+	barrier->shm = &gdev->barrier_page[id];
+	init_waitqueue_head(&barrier->sleeping_wq);
+	barrier->tree = 0;
+	barrier->nodes = NULL;
+	
+	// concurrent first sleepers: the first allocation wins
+	if((old = cmpxchg(&gdev->barriers[id], NULL, barrier)))
+	{
+		kfree(barrier);
+		return old;
+	}
+	return barrier;
+}
+
+// switches barrier id to hierarchical (tree) or flat mode
+static int barrier_set_mode(struct group_dev_t *gdev, unsigned int id, int tree)
+{
+	struct barrier_t *barrier;
+	struct barrier_node_t *nodes;
+	int node;
+	
+	if(!(barrier = barrier_get(gdev, id)))
+		return -ENOMEM;
+	
+	if(tree && !READ_ONCE(barrier->nodes))
+	{
+		if(!(nodes = kcalloc(nr_node_ids, sizeof(struct barrier_node_t), GFP_KERNEL)))
+			return -ENOMEM;
+		for_each_node(node)
+		{
+			atomic_set(&nodes[node].sleepers, 0);
+			init_waitqueue_head(&nodes[node].sleeping_wq);
+		}
+		
+		// concurrent switches: the first allocation wins, never freed until exit
+		if(cmpxchg(&barrier->nodes, NULL, nodes))
+			kfree(nodes);
+	}
+	
+	// pairs with barrier_wait(): tree sleepers find nodes allocated
+	smp_store_release(&barrier->tree, tree);
+	return 0;
+}
+
+// wakes barrier id's kernel sleepers up, if any
+static void barrier_wake(struct group_dev_t *gdev, unsigned int id)
+{
+	struct barrier_t *barrier;
+	struct barrier_node_t *nodes;
+	unsigned int sleepers;
+	int node;
+	
+	if(!(sleepers = atomic_read(&gdev->barrier_page[id].sleepers)))
+		return;
+	
+	// watching files, they have no kernel side
+	if(wq_has_sleeper(&gdev->pollers))
+		wake_up_interruptible_poll(&gdev->pollers, EPOLLPRI);
+	
+	// sleepers allocated the kernel side before going to sleep
+	smp_rmb();
+	if(!(barrier = READ_ONCE(gdev->barriers[id])))
+		return;
+	
+	// sleepers of either mode (a switch may have just happened)
+	if(wq_has_sleeper(&barrier->sleeping_wq))
+		wake_up_interruptible(&barrier->sleeping_wq);
+	
+	// tree mode: wake the first sleepers of each node, they wake the others
+	if((nodes = READ_ONCE(barrier->nodes)))
+	{
+		for_each_node(node)
+		{
+			if(atomic_read(&nodes[node].sleepers))
+				wake_up_interruptible_nr(&nodes[node].sleeping_wq, BARRIER_FANOUT);
+		}
+	}
+	gdev_stat_inc(gdev, barrier_wakeups);
+	trace_group_barrier_wake(gdev->minor, id, sleepers);
+}
+
+// releases generation of barrier id, unless someone else already did
+static int barrier_release(struct group_dev_t *gdev, unsigned int id, unsigned int generation)
+{
+	struct barrier_shm_t *shm = &gdev->barrier_page[id];
+	s64 state = atomic64_read(&shm->state), old;
+	
+	// next generation, arrivals restart from 0 (late arrivals included)
+	while(barrier_gen(state) == generation)
+	{
+		if((old = atomic64_cmpxchg(&shm->state, state, barrier_next(state))) == state)
+		{
+			barrier_wake(gdev, id);
+			return 1;
+		}
+		state = old;
+	}
+	return 0;
+}
+
+/* Tree mode: sleepers are partitioned by NUMA node, the shared sleepers 
+ * word only counts nodes having sleepers. Each released sleeper wakes 
+ * BARRIER_FANOUT more sleepers of its node, so that wake-ups spread 
+ * over the woken CPUs instead of the releaser walking all of them. */
+static int barrier_wait_tree(struct barrier_t *barrier, unsigned int generation, ktime_t timeout)
+{
+	struct barrier_node_t *node = &barrier->nodes[numa_node_id()];
+	ktime_t expires = ktime_add_safe(ktime_get(), timeout);
+	int err = 0;
+	DEFINE_WAIT(wait);
+	
+	// first sleeper of the node registers it
+	if(atomic_inc_return(&node->sleepers) == 1)
+		atomic_inc(&barrier->shm->sleepers);
+	smp_mb__after_atomic();
+	
+	for(;;)
+	{
+		prepare_to_wait_exclusive(&node->sleeping_wq, &wait, TASK_INTERRUPTIBLE);
+		
+		if(barrier_gen(atomic64_read(&barrier->shm->state)) != generation)
+			break;
+		if(signal_pending(current))
+		{
+			err = -ERESTARTSYS;
+			break;
+		}
+		if(!schedule_hrtimeout(timeout == KTIME_MAX ? NULL : &expires, HRTIMER_MODE_ABS))
+		{
+			err = -ETIMEDOUT;
+			break;
+		}
+	}
+	finish_wait(&node->sleeping_wq, &wait);
+	
+	// released, possibly along with a signal or a timeout: pass the wake-up on
+	if(barrier_gen(atomic64_read(&barrier->shm->state)) != generation)
+	{
+		err = 0;
+		wake_up_interruptible_nr(&node->sleeping_wq, BARRIER_FANOUT);
+	}
+	
+	// last sleeper of the node unregisters it
+	if(atomic_dec_and_test(&node->sleepers))
+		atomic_dec(&barrier->shm->sleepers);
+	
+	return err;
+}
+
+/* Broadcasting releases keep the payload slot's seq odd across the release, 
+ * and only write the slot once it succeeded: sleepers see the new generation 
+ * before reading seq, so they wait for the outcome, and a release won by 
+ * someone else (no arrivals left) leaves the slot untouched. The slot is 
+ * tagged with the generation entered, and the one of the broadcast before. */
+static int barrier_release_payload(struct group_dev_t *gdev, unsigned int id, 
+		const char *data, unsigned int size)
+{
+	struct barrier_shm_t *shm = &gdev->barrier_page[id];
+	struct barrier_payload_t *payload = &gdev->barrier_payloads[id];
+	s64 state;
+	
+	spin_lock(&gdev->payload_lock);
+	atomic_inc(&payload->seq);
+	smp_mb__after_atomic();
+	do {
+		state = atomic64_read(&shm->state);
+		
+		// no one sleeping, nothing to release
+		if(!barrier_arrivals(state))
+		{
+			smp_wmb();
+			atomic_inc(&payload->seq);
+			spin_unlock(&gdev->payload_lock);
+			return 2;
+		}
+	} while(atomic64_cmpxchg(&shm->state, state, barrier_next(state)) != state);
+	
+	WRITE_ONCE(payload->previous, READ_ONCE(payload->generation));
+	WRITE_ONCE(payload->generation, barrier_gen(state) + 1);
+	WRITE_ONCE(payload->size, size);
+	memcpy(payload->data, data, size);
+	smp_wmb();
+	atomic_inc(&payload->seq);
+	spin_unlock(&gdev->payload_lock);
+	
+	barrier_wake(gdev, id);
+	return 0;
+}
+
+/* Sleepers released into generation take the payload if the slot is tagged 
+ * with it. A slot tagged earlier means the release broadcast none. A later 
+ * tag means later broadcasts overwrote the slot: if the one before it is 
+ * still earlier, the release broadcast none, otherwise it may have been lost. */
+static int barrier_payload_size(unsigned int tag, unsigned int previous, 
+		unsigned int generation, unsigned int size)
+{
+	if(tag == generation)
+		return size;
+	if((int) (tag - generation) < 0 || (int) (previous - generation) < 0)
+		return 0;
+	return -EAGAIN;
+}
+
+/* reads the payload of barrier id into buf, returns its size (0: generation 
+ * has none) or -EAGAIN if a later broadcast overwrote it */
+static int barrier_payload_read(struct group_dev_t *gdev, unsigned int id, 
+		unsigned int generation, char *buf)
+{
+	struct barrier_payload_t *payload = &gdev->barrier_payloads[id];
+	unsigned int seq, tag, previous, size;
+	int tries;
+	
+	// after the release was seen
+	smp_rmb();
+	for(tries = 0; tries < BARRIER_PAYLOAD_RETRIES; tries++)
+	{
+		if((seq = atomic_read(&payload->seq)) & 1)
+		{
+			cpu_relax();
+			continue;
+		}
+		smp_rmb();
+		tag = READ_ONCE(payload->generation);
+		previous = READ_ONCE(payload->previous);
+		size = min_t(unsigned int, READ_ONCE(payload->size), BARRIER_PAYLOAD_MAX);
+		memcpy(buf, payload->data, size);
+		smp_rmb();
+		if(atomic_read(&payload->seq) == seq)
+			return barrier_payload_size(tag, previous, generation, size);
+	}
+	
+	// the slot is shared with userspace: don't trust seq to ever settle
+	spin_lock(&gdev->payload_lock);
+	tag = READ_ONCE(payload->generation);
+	previous = READ_ONCE(payload->previous);
+	size = min_t(unsigned int, READ_ONCE(payload->size), BARRIER_PAYLOAD_MAX);
+	memcpy(buf, payload->data, size);
+	spin_unlock(&gdev->payload_lock);
+	
+	return barrier_payload_size(tag, previous, generation, size);
+}
+
+// sleeps until barrier id leaves generation, or timeout (KTIME_MAX: none) expires
+static int barrier_wait(struct group_dev_t *gdev, unsigned int id, 
+		unsigned int generation, ktime_t timeout)
+{
+	struct barrier_t *barrier;
+	int tree, err;
+	
+	if(!(barrier = barrier_get(gdev, id)))
+		return -ENOMEM;
+	gdev_stat_inc(gdev, barrier_sleeps);
+	
+	tree = smp_load_acquire(&barrier->tree);
+	trace_group_barrier_sleep(gdev->minor, id, generation, tree);
+	gdev_status_add(gdev, 0, 0, 0, 1);
+	
+	if(tree)
+		err = barrier_wait_tree(barrier, generation, timeout);
+	else
+	{
+		atomic_inc(&barrier->shm->sleepers);
+		smp_mb__after_atomic();
+		
+		err = wait_event_interruptible_hrtimeout(barrier->sleeping_wq, 
+				barrier_gen(atomic64_read(&barrier->shm->state)) != generation, timeout);
+		
+		atomic_dec(&barrier->shm->sleepers);
+		if(err == -ETIME)
+			err = -ETIMEDOUT;
+	}
+	
+	gdev_status_add(gdev, 0, 0, 0, -1);
+	trace_group_barrier_woken(gdev->minor, id, generation, err);
+	return err;
+}
+
+// relative timeout of a wait, KTIME_MAX if untimed
+static ktime_t wait_timeout(int timed, int abstime, s64 timeout)
+{
+	if(!timed)
+		return KTIME_MAX;
+	
+	if(abstime)
+		return ktime_sub(ns_to_ktime(timeout), ktime_get());
+	
+	return ns_to_ktime(timeout);
+}
+
+// relative timeout of a barrier_wait_t
+static ktime_t barrier_timeout(struct barrier_wait_t *wait)
+{
+	return wait_timeout(wait->flags & BARRIER_WAIT_TIMED, 
+			wait->flags & BARRIER_WAIT_ABSTIME, wait->timeout);
+}
+
+// withdraws an arrival from barrier id, unless generation was already released
+static int barrier_cancel(struct group_dev_t *gdev, unsigned int id, unsigned int generation)
+{
+	struct barrier_shm_t *shm = &gdev->barrier_page[id];
+	s64 state = atomic64_read(&shm->state), old;
+	
+	while(barrier_gen(state) == generation)
+	{
+		if((old = atomic64_cmpxchg(&shm->state, state, state-1)) == state)
+			return 1;
+		state = old;
+	}
+	return 0;
+}
+
+
+// ------------- FILE OPERATIONS --------------------- //
+
+int group_open(struct inode *inode, struct file *filp)
+{
+	struct group_dev_t *gdev;
+	
+	// the group may be concurrently uninstalled
+	rcu_read_lock();
+	gdev = idr_find(&minors, iminor(inode));
+	if (gdev && !kref_get_unless_zero(&gdev->kref))
+		gdev = NULL;
+	rcu_read_unlock();
+	
+	if (!gdev)
+		return -ENODEV;
+	
+	return gfile_open(filp, gdev);
+}
+
+int group_release(struct inode *inode, struct file *filp)
+{
+	struct group_file_t *gfile = filp->private_data;
+	unsigned int id;
+	
+	// watches count as sleepers
+	for_each_set_bit(id, gfile->watching, BARRIERS)
+		atomic_dec(&gfile->gdev->barrier_page[id].sleepers);
+	
+	kref_put(&gfile->gdev->kref, gdev_release);
+	kfree(gfile->bufs);
+	kfree(gfile);
+	return 0;
+}
+
+// size of the head message, 0 if none
+static size_t gdev_peek(struct group_dev_t *gdev)
+{
+	size_t size = 0;
+	
+	gdev_lock_published(gdev);
+	if (!list_empty(&gdev->published_list))
+		size = list_first_entry(&gdev->published_list, struct msg_t, node)->size;
+	gdev_unlock_published(gdev);
+	
+	return size;
+}
+
+/* EPOLLIN while messages are queued, EPOLLPRI once a barrier watched 
+ * through WATCH_BARRIER left its generation, until it is watched again. */
+__poll_t group_poll(struct file *filp, poll_table *wait)
+{
+	struct group_file_t *gfile = filp->private_data;
+	struct group_dev_t *gdev = gfile->gdev;
+	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
+	unsigned int id;
+	
+	poll_wait(filp, &gdev->readers, wait);
+	poll_wait(filp, &gdev->pollers, wait);
+	
+	if (gdev_peek(gdev))
+		mask |= EPOLLIN | EPOLLRDNORM;
+	
+	for_each_set_bit(id, gfile->watching, BARRIERS)
+	{
+		if (barrier_gen(atomic64_read(&gdev->barrier_page[id].state)) != READ_ONCE(gfile->watched[id]))
+		{
+			mask |= EPOLLPRI;
+			break;
+		}
+	}
+	return mask;
+}
+
+/* Dequeues the head message into buf. Messages longer than count are 
+ * truncated or, if !truncate, left queued: -EMSGSIZE, their size in *needed. 
+ * A delivery record, if any, is written along with the message: if either 
+ * copy faults, the message goes back to the head of the queue. */
+static ssize_t gdev_deliver(struct group_dev_t *gdev, char __user *buf, size_t count, 
+		int truncate, size_t *needed, struct group_delivery_t __user *record, unsigned int buffer)
+{
+	struct msg_t* msg;
+	size_t n;
+	
+	// atomically dequeue message
+	gdev_lock_published(gdev);
+	if (list_empty(&gdev->published_list))
+	{
+		gdev_unlock_published(gdev);
+		return 0; // EOF
+	}
+	msg = list_first_entry(&gdev->published_list, struct msg_t, node);
+	if (!truncate && msg->size > count)
+	{
+		*needed = msg->size;
+		gdev_unlock_published(gdev);
+		return -EMSGSIZE;
+	}
+	list_del(&msg->node);
+	gdev_unlock_published(gdev);
+	
+	// data transfers
+	n = min(msg->size, count);
+	if (copy_to_user(buf, msg->text, n) || (record && 
+			(put_user(buffer, &record->buffer) || put_user(n, &record->size))))
+	{
+		// in case of errors, recover atomically re-enqueuing the message
+		gdev_lock_published(gdev);
+		list_add(&msg->node, &gdev->published_list);
+		gdev_unlock_published(gdev);
+		return -EFAULT;
+	}
+	
+	// atomically decrease group size
+	gdev_lock_size(gdev);
+	gdev->size -= msg->size;
+	gdev_unlock_size(gdev);
+	
+	if (gdev->read_lat)
+		lat_record(gdev->read_lat, ktime_get_ns() - msg->stamp);
+	gdev_stat_inc(gdev, msgs_read);
+	gdev_stat_add(gdev, bytes_read, n);
+	gdev_status_add(gdev, 0, 1, 0, 0);
+	trace_group_read(gdev->minor, msg->size, count, READ_ONCE(gdev->size));
+	
+	// atomically defer deallocation, msg is no longer ours
+	lock_published_work();
+	list_add_tail(&msg->node, next_published_list);
+	unlock_published_work();
 	
 	queue_work(groups_wq, &published_work);
 	
 	return n;
 }
 
+ssize_t group_read(struct file *filp, char __user *buf, size_t count,
+		loff_t *f_pos) {
+	struct group_dev_t *gdev = file_gdev(filp);
+	
+	return gdev_deliver(gdev, buf, count, 1, NULL, NULL, 0);
+}
+
 ssize_t group_write(struct file *filp, const char __user *buf, size_t count,
 		loff_t *f_pos) {
-	struct group_dev_t *gdev = filp->private_data;
+	struct group_dev_t *gdev = file_gdev(filp);
 	struct delayed_msg_t* delayed_msg;
 	struct msg_t* msg;
 	int err = 0;
@@ -452,23 +2004,29 @@ ssize_t group_write(struct file *filp, const char __user *buf, size_t count,
 		goto failed_copyfromuser;
 	}
 	INIT_LIST_HEAD(&msg->node);
+	if (gdev->read_lat)
+		msg->stamp = ktime_get_ns();
 	
 	// atomic size checks
-	spin_lock(&gdev->size_lock);
+	gdev_lock_size(gdev);
 	if(count > gdev->max_msg_size)  // message ok?
 	{
-		spin_unlock(&gdev->size_lock);
+		gdev_unlock_size(gdev);
+		gdev_stat_inc(gdev, rejected_msgsize);
 		err = -EMSGSIZE;
 		goto failed_message_size;
 	}
 	else if(count + gdev->size > gdev->max_strg_size)  // storage ok?
 	{
-		spin_unlock(&gdev->size_lock);
+		gdev_unlock_size(gdev);
+		gdev_stat_inc(gdev, rejected_nospc);
 		err = -ENOSPC;
 		goto failed_storage_size;
 	}
 	gdev->size += msg->size;
-	spin_unlock(&gdev->size_lock);
+	if(gdev->size > gdev->peak_size)
+		gdev->peak_size = gdev->size;
+	gdev_unlock_size(gdev);
 	
 	// atomically read delay
 	delay = (unsigned int) atomic_read(&gdev->delay);
@@ -477,9 +2035,11 @@ ssize_t group_write(struct file *filp, const char __user *buf, size_t count,
 	if(!delay)  // immediate operating mode?
 	{
 		// atomically append msg
-		spin_lock_bh(&gdev->published_list_lock);
+		gdev_status_add(gdev, 1, 0, 0, 0);
+		gdev_lock_published(gdev);
 		list_add_tail(&msg->node, &gdev->published_list);
-		spin_unlock_bh(&gdev->published_list_lock);
+		gdev_unlock_published(gdev);
+		wake_up_interruptible(&gdev->readers);
 	}
 	else
 	{
@@ -491,6 +2051,7 @@ ssize_t group_write(struct file *filp, const char __user *buf, size_t count,
 		}
 		delayed_msg->gdev = gdev;
 		delayed_msg->msg = msg;
+		delayed_msg->delay = delay;
 		delayed_msg->is_revoked = 0;
 		delayed_msg->is_flushed = 0;
 		INIT_LIST_HEAD(&delayed_msg->node);
@@ -502,27 +2063,33 @@ ssize_t group_write(struct file *filp, const char __user *buf, size_t count,
 		list_add_tail(&delayed_msg->node, &gdev->delayed_list);
 		add_timer(&delayed_msg->timer); // activate timer
 		spin_unlock_bh(&gdev->delayed_list_lock);
+		gdev_stat_inc(gdev, msgs_delayed);
+		gdev_status_add(gdev, 0, 0, 1, 0);
 	}
 	
+	gdev_stat_inc(gdev, msgs_written);
+	gdev_stat_add(gdev, bytes_written, count);
+	trace_group_write(gdev->minor, count, delay, READ_ONCE(gdev->size), count);
 	return count;
 
 failed_timeralloc:
 	// atomically decrease gdev->size
-	spin_lock(&gdev->size_lock);
+	gdev_lock_size(gdev);
 	gdev->size -= msg->size;
-	spin_unlock(&gdev->size_lock);
+	gdev_unlock_size(gdev);
 failed_storage_size:
 failed_message_size:
 failed_copyfromuser:
 	vfree(msg->text);
 failed_textalloc:
 	kmem_cache_free(msg_cache, msg);
+	trace_group_write(gdev->minor, count, delay, READ_ONCE(gdev->size), err);
 	return err;
 }
 
 long group_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
-	struct group_dev_t *gdev = filp->private_data;
+	struct group_dev_t *gdev = file_gdev(filp);
 	int res = 0;
 	
 	// verifying cmd
@@ -534,151 +2101,718 @@ long group_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	// dispatching command
 	switch (cmd)
 	{
+		/* returns:
+		 * BARRIER_SERIAL_THREAD to the last party of a counting barrier
+		 * 0 to any other released sleeper
+		 * -ETIMEDOUT if the timed variant expired
+		 * the timed variant also hands the release payload back, if asked:
+		 * -EAGAIN if released, but a later broadcast overwrote the payload */
 		case SLEEP_ON_BARRIER:
+		case SLEEP_ON_BARRIER_TIMED:
+		{
+			struct barrier_wait_t wait = { .barrier = 0, .flags = 0, .payload = NULL };
+			char data[BARRIER_PAYLOAD_MAX];
+			struct barrier_shm_t *shm;
+			unsigned int parties;
+			s64 state;
+			int err, size;
+
+			if (cmd == SLEEP_ON_BARRIER_TIMED && 
+					copy_from_user(&wait, (struct barrier_wait_t*) arg, sizeof(struct barrier_wait_t)))
+				return -EFAULT;
+			
+			if (wait.barrier >= BARRIERS)
+				return -EINVAL;
+			if ((err = gdev_barrier_pages(gdev)))
+				return err;
+
+			shm = &gdev->barrier_page[wait.barrier];
+			parties = atomic_read(&shm->parties);
+			state = atomic64_inc_return(&shm->state);
+
+			// last party shall release the barrier
+			if(parties && barrier_arrivals(state) >= parties && 
+					barrier_release(gdev, wait.barrier, barrier_gen(state)))
+			{
+				res = BARRIER_SERIAL_THREAD;
+				break;
+			}
+
+			// until the generation changes, keep sleeping
+			if((err = barrier_wait(gdev, wait.barrier, barrier_gen(state), barrier_timeout(&wait))))
+			{
+				// not released yet: leave the barrier
+				if(barrier_cancel(gdev, wait.barrier, barrier_gen(state)))
+					return err;
+			}
+
+			if(wait.payload)
+			{
+				size = barrier_payload_read(gdev, wait.barrier, barrier_gen(state) + 1, data);
+				if(put_user(max(size, 0), &((struct barrier_wait_t __user*) arg)->payload_size) ||
+						(size > 0 && copy_to_user(wait.payload, data, 
+							min_t(unsigned int, size, wait.payload_size))))
+					return -EFAULT;
+				if(size < 0)
+					return size;
+			}
+			break;
+		}
+
+		/* returns: 
+		 * 0 if sleepers were released
+		 * 2 if no one was sleeping */
+		case AWAKE_BARRIER:
+		case AWAKE_BARRIER_ID:
+		{
+			unsigned int id = cmd == AWAKE_BARRIER_ID ? arg : 0;
+			s64 state;
+			
+			if (id >= BARRIERS)
+				return -EINVAL;
+			
+			// no one sleeping, nothing to release
+			if(!smp_load_acquire(&gdev->barrier_page))
+			{
+				res = 2;
+				break;
+			}
+			state = atomic64_read(&gdev->barrier_page[id].state);
+			if(!barrier_arrivals(state))
+			{
+				res = 2;
+				break;
+			}
+
+			barrier_release(gdev, id, barrier_gen(state));
+			break;
+		}
+		
+		/* returns: 
+		 * 0 if sleepers were released, along with the payload
+		 * 2 if no one was sleeping */
+		case AWAKE_BARRIER_PAYLOAD:
+		{
+			struct barrier_awake_t awake;
+			char data[BARRIER_PAYLOAD_MAX];
+
+			if (copy_from_user(&awake, (struct barrier_awake_t*) arg, sizeof(struct barrier_awake_t)))
+				return -EFAULT;
+			
+			if (awake.barrier >= BARRIERS || awake.size > BARRIER_PAYLOAD_MAX)
+				return -EINVAL;
+			
+			// no one sleeping, nothing to release
+			if (!smp_load_acquire(&gdev->barrier_page))
+			{
+				res = 2;
+				break;
+			}
+			
+			if (copy_from_user(data, awake.payload, awake.size))
+				return -EFAULT;
+
+			res = barrier_release_payload(gdev, awake.barrier, data, awake.size);
+			break;
+		}
+		
+		/* returns:
+		 * 0 if the party count is set
+		 * BARRIER_SERIAL_THREAD if setting it released the barrier */
+		case SET_BARRIER_PARTIES:
+		{
+			struct barrier_conf_t conf;
+			struct barrier_shm_t *shm;
+			s64 state, old;
+
+			if (copy_from_user(&conf, (struct barrier_conf_t*) arg, sizeof(struct barrier_conf_t)))
+				return -EFAULT;
+			
+			if (conf.barrier >= BARRIERS)
+				return -EINVAL;
+			if ((res = gdev_barrier_pages(gdev)))
+				return res;
+
+			shm = &gdev->barrier_page[conf.barrier];
+			atomic_set(&shm->parties, conf.parties);
+			
+			// enough sleepers are already waiting
+			state = atomic64_read(&shm->state);
+			while(conf.parties && barrier_arrivals(state) >= conf.parties)
+			{
+				old = atomic64_cmpxchg(&shm->state, state, barrier_next(state));
+				if(old == state)
+				{
+					barrier_wake(gdev, conf.barrier);
+					res = BARRIER_SERIAL_THREAD;
+					break;
+				}
+				state = old;
+			}
+			break;
+		}
+		
+		case SET_BARRIER_MODE:
+		{
+			struct barrier_conf_t conf;
+
+			if (copy_from_user(&conf, (struct barrier_conf_t*) arg, sizeof(struct barrier_conf_t)))
+				return -EFAULT;
+			
+			if (conf.barrier >= BARRIERS || conf.mode > BARRIER_TREE)
+				return -EINVAL;
+			if ((res = gdev_barrier_pages(gdev)))
+				return res;
+
+			res = barrier_set_mode(gdev, conf.barrier, conf.mode == BARRIER_TREE);
+			break;
+		}
+		
+		// userspace already arrived: sleep unless released meanwhile
+		case WAIT_ON_BARRIER:
+		{
+			struct barrier_wait_t wait;
+
+			if (copy_from_user(&wait, (struct barrier_wait_t*) arg, sizeof(struct barrier_wait_t)))
+				return -EFAULT;
+			
+			if (wait.barrier >= BARRIERS)
+				return -EINVAL;
+			if ((res = gdev_barrier_pages(gdev)))
+				return res;
+
+			res = barrier_wait(gdev, wait.barrier, wait.generation, barrier_timeout(&wait));
+			break;
+		}
+		
+		// userspace already released: wake kernel sleepers up
+		case WAKE_BARRIER:
+		{
+			if (arg >= BARRIERS)
+				return -EINVAL;
+			
+			if (smp_load_acquire(&gdev->barrier_page))
+				barrier_wake(gdev, arg);
+			break;
+		}
+		
+		/* returns:
+		 * 0 once poll() on the file reports EPOLLPRI when the barrier leaves generation
+		 * 1 if it already did
+		 * an earlier generation watched by the file is kept, unless BARRIER_WATCH_SET */
+		case WATCH_BARRIER:
 		{
-			spin_lock(&gdev->barrier_lock);
+			struct group_file_t *gfile = filp->private_data;
+			struct barrier_wait_t watch;
+			unsigned int generation;
 
-			gdev->sleepers++;
+			if (copy_from_user(&watch, (struct barrier_wait_t*) arg, sizeof(struct barrier_wait_t)))
+				return -EFAULT;
+			
+			if (watch.barrier >= BARRIERS)
+				return -EINVAL;
+			if ((res = gdev_barrier_pages(gdev)))
+				return res;
+			
+			spin_lock(&gfile->watch_lock);
+			generation = watch.generation;
+			if (!test_bit(watch.barrier, gfile->watching))
+			{
+				// a sleeper, as far as releasers are concerned
+				atomic_inc(&gdev->barrier_page[watch.barrier].sleepers);
+				WRITE_ONCE(gfile->watched[watch.barrier], generation);
+				smp_mb__before_atomic();
+				set_bit(watch.barrier, gfile->watching);
+			}
+			else if ((watch.flags & BARRIER_WATCH_SET) || 
+					(int) (generation - gfile->watched[watch.barrier]) < 0)
+				WRITE_ONCE(gfile->watched[watch.barrier], generation);
+			else
+				generation = gfile->watched[watch.barrier];
+			spin_unlock(&gfile->watch_lock);
+			
+			// registered before checking the generation, as sleepers are
+			smp_mb();
+			res = barrier_gen(atomic64_read(&gdev->barrier_page[watch.barrier].state)) != generation;
+			break;
+		}
+		
+		case UNWATCH_BARRIER:
+		{
+			struct group_file_t *gfile = filp->private_data;
+			
+			if (arg >= BARRIERS)
+				return -EINVAL;
+			
+			spin_lock(&gfile->watch_lock);
+			if (test_and_clear_bit(arg, gfile->watching))
+				atomic_dec(&gdev->barrier_page[arg].sleepers);
+			spin_unlock(&gfile->watch_lock);
+			break;
+		}
+		
+		/* returns: 
+		 * 0 if the device already existed
+		 * 1 if it is installed */
+		case INSTALL_GROUP:
+		{
+			struct group_t *u_group = (struct group_t*) arg;
+			struct group_dev_t *target;
+			char id[32], devname[sizeof(u_group->devname)];
+			int err;
 
-			// until alarm is off, keep sleeping
-			while(!gdev->wakeup)
+			if (copy_from_user(id, u_group->id, 32))
+			{
+				return -EFAULT;
+			}
+			
+			if (IS_ERR(target = gdev_install(id, &res)))
+				return PTR_ERR(target);
+			
+			// the caller will open it by path
+			if ((err = gdev_export(target)))
 			{
-				spin_unlock(&gdev->barrier_lock);
+				kref_put(&target->kref, gdev_release);
+				return err;
+			}
+			
+			memcpy(devname, target->group->devname, sizeof(devname));
+			kref_put(&target->kref, gdev_release);
+
+			// return pathname to userspace
+			if (copy_to_user(u_group->devname, devname, sizeof(devname)))
+				return -EFAULT;
+
+			break;
+		}
+		
+		/* returns:
+		 * a file descriptor of the group, open for reading and writing, 
+		 * whether it was installed or not is reported through the argument */
+		case INSTALL_GROUP_FD:
+		{
+			struct group_fd_t *u_install = (struct group_fd_t*) arg;
+			struct group_dev_t *target;
+			char id[32];
+			int installed;
 
-				if(wait_event_interruptible(gdev->sleeping_wq, gdev->wakeup))
+			if (copy_from_user(id, u_install->group.id, 32))
+				return -EFAULT;
+			
+			if (IS_ERR(target = gdev_install(id, &installed)))
+				return PTR_ERR(target);
+			
+			// reported first: once the fd is installed, it can't be taken back
+			if (copy_to_user(u_install->group.devname, target->group->devname, 
+						sizeof(u_install->group.devname)) ||
+					put_user(installed, &u_install->installed))
+			{
+				kref_put(&target->kref, gdev_release);
+				return -EFAULT;
+			}
+			
+			// the file inherits the reference
+			if ((res = gfile_getfd(target)) < 0)
+				kref_put(&target->kref, gdev_release);
+			break;
+		}
+		
+		/* returns:
+		 * 0 if all groups were resolved, installing the missing ones
+		 * the first error otherwise, unresolved groups get an empty devname
+		 * either way, installed counts the groups installed by the call 
+		 * and, if asked, each resolved group gets a file descriptor
+		 * -EFAULT if the results can't be reported, no descriptor is installed then */
+		case INSTALL_GROUPS:
+		{
+			struct group_batch_t batch, __user *u_batch = (struct group_batch_t*) arg;
+			struct group_dev_t **targets;
+			struct group_t *k_groups;
+			struct file **files = NULL;
+			int *fds = NULL, reported;
+			unsigned int i;
+
+			if (copy_from_user(&batch, u_batch, sizeof(struct group_batch_t)))
+				return -EFAULT;
+			
+			if (!batch.count || batch.count > GROUPS_BATCH_MAX)
+				return -EINVAL;
+			
+			if (!(k_groups = kvmalloc_array(batch.count, sizeof(struct group_t), GFP_KERNEL)))
+				return -ENOMEM;
+			if (!(targets = kvcalloc(batch.count, sizeof(struct group_dev_t*), GFP_KERNEL)) ||
+					(batch.fds && 
+						(!(fds = kvmalloc_array(batch.count, sizeof(int), GFP_KERNEL)) ||
+						!(files = kvcalloc(batch.count, sizeof(struct file*), GFP_KERNEL)))))
+			{
+				res = -ENOMEM;
+				goto batch_out;
+			}
+			
+			if (copy_from_user(k_groups, batch.groups, batch.count * sizeof(struct group_t)))
+			{
+				res = -EFAULT;
+				goto batch_out;
+			}
+			
+			res = gdev_install_batch(k_groups, targets, batch.count, &batch.installed);
+			
+			for (i = 0; i < batch.count; i++)
+			{
+				if (fds)
+					fds[i] = -1;
+				if (!targets[i])
 				{
-					spin_lock(&gdev->barrier_lock);
-					// last sleeper shall turn off the alarm
-					if (!(--gdev->sleepers)) gdev->wakeup = 0;
-					spin_unlock(&gdev->barrier_lock);
-					return -ERESTARTSYS;
+					k_groups[i].devname[0] = '\0';
+					continue;
+				}
+				memcpy(k_groups[i].devname, targets[i]->group->devname, sizeof(k_groups[i].devname));
+				
+				// descriptors are reserved, the file inherits the reference
+				if (fds && (fds[i] = get_unused_fd_flags(O_RDWR)) >= 0 && 
+						IS_ERR(files[i] = gfile_getfile(targets[i])))
+				{
+					put_unused_fd(fds[i]);
+					fds[i] = PTR_ERR(files[i]);
+					files[i] = NULL;
+				}
+				if (!fds)
+					kref_put(&targets[i]->kref, gdev_release);
+				else if (fds[i] < 0)
+				{
+					if (!res)
+						res = fds[i];
+					fds[i] = -1;
+					kref_put(&targets[i]->kref, gdev_release);
+				}
+			}
+			
+			reported = !copy_to_user(batch.groups, k_groups, batch.count * sizeof(struct group_t)) &&
+					!put_user(batch.installed, &u_batch->installed) &&
+					!(fds && copy_to_user(batch.fds, fds, batch.count * sizeof(int)));
+			if (!reported)
+				res = -EFAULT;
+			
+			// installed only once userspace knows them, they can't be taken back
+			for (i = 0; files && i < batch.count; i++)
+			{
+				if (!files[i])
+					continue;
+				if (reported)
+					fd_install(fds[i], files[i]);
+				else
+				{
+					put_unused_fd(fds[i]);
+					fput(files[i]);
 				}
+			}
+			
+batch_out:
+			kvfree(files);
+			kvfree(fds);
+			kvfree(targets);
+			kvfree(k_groups);
+			break;
+		}
+		
+		/* returns:
+		 * 0 once the group has its /dev node and sysfs attributes
+		 * -ENODEV if it was uninstalled meanwhile
+		 * -EOPNOTSUPP for groupfs groups */
+		case EXPORT_GROUP:
+		{
+			return gdev_export(gdev);
+		}
+		
+		/* returns:
+		 * 0 if the group was uninstalled, it lives on until its last close
+		 * -ENOENT if no group has the id
+		 * -EPERM for the module's own group */
+		case UNINSTALL_GROUP:
+		{
+			struct group_t *u_group = (struct group_t*) arg;
+			struct group_dev_t *target;
+			char id[32];
 
-				spin_lock(&gdev->barrier_lock);
+			if (copy_from_user(id, u_group->id, 32))
+				return -EFAULT;
+			
+			lock_install();
+			rcu_read_lock();
+			target = gdev_lookup(id);
+			rcu_read_unlock();
+			
+			if (!target || target->minor == 0)
+			{
+				unlock_install();
+				return target ? -EPERM : -ENOENT;
 			}
+			
+			rhashtable_remove_fast(&groups_htbl, &target->hnode, groups_params);
+			gdev_unregister(target);
+			unlock_install();
+			
+			printk(KERN_INFO "%s: <id=%.32s>, device unregistered.\n", KBUILD_MODNAME, id);
+			trace_group_uninstall(id, target->minor);
+			
+			// the installation reference
+			kref_put(&target->kref, gdev_release);
+			break;
+		}
+		
+		case SET_SEND_DELAY:
+		{
+			unsigned int delay;
 
-			// last sleeper shall turn off the alarm
-			if(!(--gdev->sleepers)) gdev->wakeup = 0;
+			if (copy_from_user(&delay, (unsigned long*) arg, sizeof(unsigned int)))
+				return -EFAULT;
 
-			spin_unlock(&gdev->barrier_lock);
+			atomic_set(&gdev->delay, (int) delay);
 			break;
 		}
-
-		/* returns: 
-		 * 0 if the alarm is set
-		 * 1 if alarm was already on
-		 * 2 if no one was sleeping (alarm is not set) */
-		case AWAKE_BARRIER:
+		
+		/* returns:
+		 * 0, all parameters are read at once */
+		case GET_CONFIG:
 		{
-			spin_lock(&gdev->barrier_lock);
-
-			// no one sleeping, not setting the alarm
-			if(!gdev->sleepers)
+			struct group_config_t config = { .mask = GROUP_CONFIG_ALL };
+			
+			gdev_lock_size(gdev);
+			config.delay = (unsigned int) atomic_read(&gdev->delay);
+			config.max_message_size = gdev->max_msg_size;
+			config.max_storage_size = gdev->max_strg_size;
+			config.size = gdev->size;
+			gdev_unlock_size(gdev);
+			
+			if (copy_to_user((struct group_config_t*) arg, &config, sizeof(config)))
+				return -EFAULT;
+			break;
+		}
+		
+		/* returns:
+		 * 0, counters are summed over CPUs: not a consistent snapshot */
+		case GET_STATS:
+		{
+			struct group_stats_t stats;
+			
+			gdev_stats(gdev, &stats);
+			if (copy_to_user((struct group_stats_t*) arg, &stats, sizeof(stats)))
+				return -EFAULT;
+			break;
+		}
+		
+		/* returns:
+		 * 0, the masked parameters are updated at once
+		 * -EINVAL on unknown mask bits or non-zero reserved fields
+		 * -EPERM on size limits, without CAP_SYS_ADMIN (as their sysfs attributes) */
+		case SET_CONFIG:
+		{
+			struct group_config_t config;
+			int i;
+			
+			if (copy_from_user(&config, (struct group_config_t*) arg, sizeof(config)))
+				return -EFAULT;
+			if (config.mask & ~GROUP_CONFIG_ALL)
+				return -EINVAL;
+			// reserved fields must stay zero, so they can be given a meaning later
+			for (i = 0; i < ARRAY_SIZE(config.reserved); i++)
+				if (config.reserved[i])
+					return -EINVAL;
+			if ((config.mask & ~GROUP_CONFIG_DELAY) && !capable(CAP_SYS_ADMIN))
+				return -EPERM;
+			
+			gdev_lock_size(gdev);
+			if (config.mask & GROUP_CONFIG_DELAY)
+				atomic_set(&gdev->delay, (int) config.delay);
+			if (config.mask & GROUP_CONFIG_MAX_MESSAGE_SIZE)
+				gdev->max_msg_size = config.max_message_size;
+			if (config.mask & GROUP_CONFIG_MAX_STORAGE_SIZE)
+				gdev->max_strg_size = config.max_storage_size;
+			gdev_unlock_size(gdev);
+			break;
+		}
+		
+		/* returns:
+		 * the size of the next message to be delivered, 0 if none */
+		case PEEK_MESSAGE_SIZE:
+		{
+			return gdev_peek(gdev);
+		}
+		
+		/* returns:
+		 * amount of bytes read, 0 if no message is published
+		 * -EMSGSIZE if the message doesn't fit: it stays queued, 
+		 * its size is reported through the argument */
+		case READ_MESSAGE:
+		{
+			struct group_read_t __user *u_read = (struct group_read_t __user*) arg;
+			struct group_read_t k_read;
+			size_t needed;
+			
+			if (copy_from_user(&k_read, u_read, sizeof(k_read)))
+				return -EFAULT;
+			
+			res = gdev_deliver(gdev, k_read.buf, k_read.size, 0, &needed, NULL, 0);
+			if (res == -EMSGSIZE && put_user((unsigned long) needed, &u_read->msg_size))
+				return -EFAULT;
+			break;
+		}
+		
+		/* returns:
+		 * 0, the buffers replace the previously registered ones (none if count is 0)
+		 * -EINVAL past GROUP_BUFFERS_MAX buffers or on empty ones */
+		case REGISTER_BUFFERS:
+		{
+			struct group_file_t *gfile = filp->private_data;
+			struct group_buffers_t reg;
+			struct group_buffer_t __user *u_bufs;
+			struct group_buf_t *bufs = NULL;
+			unsigned int i;
+			
+			if (copy_from_user(&reg, (struct group_buffers_t*) arg, sizeof(reg)))
+				return -EFAULT;
+			if (reg.count > GROUP_BUFFERS_MAX)
+				return -EINVAL;
+			
+			if (reg.count)
 			{
-				res = 2;
-				spin_unlock(&gdev->barrier_lock);
-				break;
+				if (!(bufs = kmalloc_array(reg.count, sizeof(struct group_buf_t), GFP_KERNEL)))
+					return -ENOMEM;
+				
+				u_bufs = reg.buffers;
+				for (i = 0; i < reg.count; i++)
+				{
+					struct group_buffer_t buf;
+					
+					if (copy_from_user(&buf, &u_bufs[i], sizeof(buf)))
+					{
+						kfree(bufs);
+						return -EFAULT;
+					}
+					if (!buf.size)
+					{
+						kfree(bufs);
+						return -EINVAL;
+					}
+					bufs[i].addr = buf.addr;
+					bufs[i].size = buf.size;
+					bufs[i].id = i;
+				}
+				
+				// best fits are the first ones fitting
+				sort(bufs, reg.count, sizeof(struct group_buf_t), group_buf_cmp, NULL);
 			}
-
-			// alarm already on, not setting the alarm
-			if(gdev->wakeup)
+			
+			if (mutex_lock_interruptible(&gfile->bufs_lock))
 			{
-				res = 1;
-				spin_unlock(&gdev->barrier_lock);
-				break;
+				kfree(bufs);
+				return -ERESTARTSYS;
 			}
-
-			gdev->wakeup = 1;
-			wake_up_interruptible(&gdev->sleeping_wq);
-			spin_unlock(&gdev->barrier_lock);
+			swap(gfile->bufs, bufs);
+			gfile->nbufs = reg.count;
+			mutex_unlock(&gfile->bufs_lock);
+			
+			kfree(bufs);
 			break;
 		}
 		
-		/* returns: 
-		 * 0 if the device already existed
-		 * 1 if it is installed */
-		case INSTALL_GROUP:
+		/* returns:
+		 * amount of messages delivered, each into the best fitting registered 
+		 * buffer not used yet by the call: 0 if none is published
+		 * -ENOBUFS if no buffer is registered
+		 * -EMSGSIZE if the first message fits no buffer, it stays queued
+		 * -ERESTARTSYS if a signal interrupted the wait */
+		case READ_MESSAGES:
 		{
-			struct group_t *k_group = kmalloc(sizeof(struct group_t), GFP_KERNEL),
-					*u_group = (struct group_t*) arg;
-			struct group_dev_t* gdev;
-			uint64_t hkey;
-			int exists = 0;
-
-			if (copy_from_user(k_group->id, u_group->id, 32))
-			{
-				return -EFAULT;
-			}
+			struct group_file_t *gfile = filp->private_data;
+			struct group_messages_t batch, __user *u_batch = (struct group_messages_t*) arg;
+			DECLARE_BITMAP(used, GROUP_BUFFERS_MAX);
+			size_t needed;
+			ssize_t n;
+			unsigned int i;
 			
-			hkey = xxh64(k_group->id, strnlen(k_group->id, 32), 1);
+			// the count is written last, it must not fault once messages are taken
+			if (copy_from_user(&batch, u_batch, sizeof(batch)) || put_user(0, &u_batch->count))
+				return -EFAULT;
+			if (!READ_ONCE(gfile->nbufs))  // checked again under bufs_lock
+				return -ENOBUFS;
 			
-			// first groups_htbl query
-			spin_lock(&htbl_lock);
-			hash_for_each_possible(groups_htbl, gdev, hnode, hkey)
+			for (batch.count = 0, res = 0; !batch.count;)
 			{
-				if (!strcmp(gdev->group->id, k_group->id))
+				// blocking calls wait for their first message, not holding bufs_lock
+				if ((batch.flags & GROUP_MESSAGES_WAIT) && !gdev_peek(gdev))
 				{
-					exists = 1;
-					break;
+					gdev_status_add(gdev, 0, 0, 0, 1);
+					res = wait_event_interruptible(gdev->readers, gdev_peek(gdev));
+					gdev_status_add(gdev, 0, 0, 0, -1);
+					if (res)
+						return res;
 				}
-			}
-			spin_unlock(&htbl_lock);
-
-			if (!exists)
-			{
-				// first query failed
-				int err = 0;
-				dev_t dev;
-				res = 1;
 				
-				// group requires installation
-				spin_lock(&install_lock);
-				
-				// second groups_htbl query
-				hash_for_each_possible(groups_htbl, gdev, hnode, hkey)
+				if (mutex_lock_interruptible(&gfile->bufs_lock))
+					return -ERESTARTSYS;
+				if (!gfile->nbufs)
 				{
-					if (!strcmp(gdev->group->id, k_group->id))
-					{
-						exists = 1;
-						break;
-					}
+					mutex_unlock(&gfile->bufs_lock);
+					return -ENOBUFS;
 				}
+				bitmap_zero(used, gfile->nbufs);
 				
-				if(!exists)
+				while (batch.count < batch.max && (needed = gdev_peek(gdev)))
 				{
-					// prereserved minor availability
-					if(groups+1 >= range)
-					{
-						spin_unlock(&install_lock);
-						return -EDQUOT;
-					}
+					// the head may change meanwhile, chosen again on EMSGSIZE
+					do {
+						for (i = 0; i < gfile->nbufs; i++)
+							if (gfile->bufs[i].size >= needed && !test_bit(i, used))
+								break;
+						n = i < gfile->nbufs ? gdev_deliver(gdev, gfile->bufs[i].addr, 
+								gfile->bufs[i].size, 0, &needed, 
+								&batch.deliveries[batch.count], gfile->bufs[i].id) : -EMSGSIZE;
+					} while (n == -EMSGSIZE && i < gfile->nbufs);
 					
-					// second query failed -> installation
-					dev = MKDEV(major, ++groups);
-					if ((err = gdev_init(&gdev, k_group, dev, hkey)))
+					if (!n)  // consumed meanwhile
+						continue;
+					if (n < 0)  // left queued, delivered ones are reported
 					{
-						groups--;
-						spin_unlock(&install_lock);
-						return err;
+						if (!batch.count)
+							res = n;
+						break;
 					}
+					set_bit(i, used);
+					batch.count++;
 				}
-				spin_unlock(&install_lock);
+				mutex_unlock(&gfile->bufs_lock);
+				
+				// blocking calls wait again if their message was consumed meanwhile
+				if (res < 0 || !(batch.flags & GROUP_MESSAGES_WAIT) || !batch.max)
+					break;
 			}
-
-			// return pathname to userspace
-			copy_to_user(u_group->devname, gdev->group->devname, 32);
-
+			
+			if (res < 0)
+				return res;
+			if (put_user(batch.count, &u_batch->count))
+				return -EFAULT;
+			res = batch.count;
 			break;
 		}
 		
-		case SET_SEND_DELAY:
+		/* returns:
+		 * 0 once a message is published, right away if one is queued
+		 * -ETIMEDOUT if the timeout expired first */
+		case WAIT_MESSAGES:
 		{
-			unsigned int delay;
-
-			if (copy_from_user(&delay, (unsigned long*) arg, sizeof(unsigned int)))
+			struct group_wait_t wait;
+			
+			if (copy_from_user(&wait, (struct group_wait_t*) arg, sizeof(struct group_wait_t)))
 				return -EFAULT;
-
-			atomic_set(&gdev->delay, (int) delay);
+			
+			gdev_status_add(gdev, 0, 0, 0, 1);
+			res = wait_event_interruptible_hrtimeout(gdev->readers, gdev_peek(gdev), 
+					wait_timeout(wait.flags & GROUP_WAIT_TIMED, 
+					wait.flags & GROUP_WAIT_ABSTIME, wait.timeout));
+			gdev_status_add(gdev, 0, 0, 0, -1);
+			if (res == -ETIME)
+				res = -ETIMEDOUT;
 			break;
 		}
 		
@@ -686,6 +2820,7 @@ long group_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		{
 			struct list_head* ptr;
 			struct delayed_msg_t* delayed_msg;
+			unsigned int revoked = 0;
 
 			spin_lock_bh(&gdev->delayed_list_lock);	
 			list_for_each(ptr, &gdev->delayed_list)
@@ -697,9 +2832,11 @@ long group_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 					ptr = ptr->prev;
 					list_del(&delayed_msg->node);
 					
-					spin_lock(&gdev->size_lock);
+					gdev_lock_size(gdev);
 					gdev->size -= delayed_msg->msg->size;
-					spin_unlock(&gdev->size_lock);
+					gdev_unlock_size(gdev);
+					gdev_stat_inc(gdev, msgs_revoked);
+					revoked++;
 					
 					// atomically defer deallocation
 					spin_lock_bh(&delayed_work_lock);
@@ -709,6 +2846,9 @@ long group_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 			}
 			spin_unlock_bh(&gdev->delayed_list_lock);
 			queue_work(groups_wq, &delayed_work);
+			if (revoked)
+				gdev_status_add(gdev, 0, 0, -revoked, 0);
+			trace_group_revoke(gdev->minor, revoked, READ_ONCE(gdev->size));
 			break;
 		}
 
@@ -723,9 +2863,10 @@ long group_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 
 int group_flush(struct file *filp, fl_owner_t id)
 {
-	struct group_dev_t *gdev = filp->private_data;
+	struct group_dev_t *gdev = file_gdev(filp);
 	struct delayed_msg_t* delayed_msg;
 	struct list_head* pos;
+	unsigned int flushed = 0;
 	
 	spin_lock_bh(&gdev->delayed_list_lock);
 	list_for_each(pos, &gdev->delayed_list)
@@ -739,9 +2880,13 @@ int group_flush(struct file *filp, fl_owner_t id)
 		if(del_timer_sync(&delayed_msg->timer))  // was timer stopped?
 		{
 			// callback was not executed: append message
-			spin_lock_bh(&gdev->published_list_lock);
+			gdev_status_add(gdev, 1, 0, -1, 0);
+			gdev_lock_published(gdev);
 			list_add_tail(&delayed_msg->msg->node, &gdev->published_list);
-			spin_unlock_bh(&gdev->published_list_lock);
+			gdev_unlock_published(gdev);
+			wake_up_interruptible(&gdev->readers);
+			gdev_stat_inc(gdev, msgs_flushed);
+			flushed++;
 		}
 		// at this point, we know the callback function:
 		// 1) will no longer trigger
@@ -755,23 +2900,341 @@ int group_flush(struct file *filp, fl_owner_t id)
 	}
 	spin_unlock_bh(&gdev->delayed_list_lock);
 	queue_work(groups_wq, &delayed_work);
+	
+	if(flushed)
+		trace_group_flush(gdev->minor, flushed, READ_ONCE(gdev->size));
+	return 0;
+}
+
+int group_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct group_dev_t *gdev = file_gdev(filp);
+	unsigned long addr, pgoff = vma->vm_pgoff;
+	void *page;
+	int err;
+	
+	// the status page is read-only, for the whole mapping
+	if(pgoff + vma_pages(vma) > STATUS_PGOFF)
+	{
+		if(vma->vm_flags & VM_WRITE)
+			return -EPERM;
+		vma->vm_flags &= ~VM_MAYWRITE;
+	}
+	
+	if(pgoff <= BARRIER_PAYLOAD_PAGES && (err = gdev_barrier_pages(gdev)))
+		return err;
+	
+	// page 0: barrier states, then barrier payloads and the status page
+	for(addr = vma->vm_start; addr < vma->vm_end; addr += PAGE_SIZE, pgoff++)
+	{
+		if(!pgoff)
+			page = gdev->barrier_page;
+		else if(pgoff <= BARRIER_PAYLOAD_PAGES)
+			page = (char*) gdev->barrier_payloads + ((pgoff-1) << PAGE_SHIFT);
+		else if(pgoff == STATUS_PGOFF)
+		{
+			if(!(page = gdev_status_page(gdev)))
+				return -ENOMEM;
+		}
+		else
+			return -EINVAL;
+		
+		if((err = remap_pfn_range(vma, addr, virt_to_phys(page) >> PAGE_SHIFT,
+				PAGE_SIZE, vma->vm_page_prot)))
+			return err;
+	}
+	return 0;
+}
+
+
+// ------------- GROUPFS ----------------------------- //
+
+/* An optional front end to groups, mounted like mqueue: creating a file 
+ * installs a group within the mount, its inode carrying the group_dev_t. 
+ * Lookups go through the dcache, no minor nor groups_htbl entry is used 
+ * and each mount is a namespace of its own. User namespaces can mount it, 
+ * so groups are bounded per mount by max_groups instead of by the minors, 
+ * and charged to the creator's memory cgroup. */
+
+#define GROUPFS_MAGIC 0x67726f75  // "grou"
+
+static bool groupfs = true;
+module_param(groupfs, bool, 0444);
+MODULE_PARM_DESC(groupfs, "Register the groupfs pseudo-filesystem (default: true)");
+
+static unsigned int groupfs_max_groups = 1024;
+module_param(groupfs_max_groups, uint, 0644);
+MODULE_PARM_DESC(groupfs_max_groups, "Default max_groups of groupfs mounts, "
+		"only CAP_SYS_ADMIN mounters may exceed it (default: 1024)");
+
+// per mount information
+struct groupfs_info_t {
+	unsigned int max_groups;
+	atomic_t groups;  // group inodes within the mount
+};
+
+enum { GROUPFS_OPT_MAX_GROUPS, GROUPFS_OPT_ERR };
+
+static const match_table_t groupfs_tokens = {
+	{ GROUPFS_OPT_MAX_GROUPS, "max_groups=%u" },
+	{ GROUPFS_OPT_ERR, NULL }
+};
+
+/* Inode operations take the mount's user namespace since 5.12, GROUPFS_USERNS 
+ * is that leading parameter or nothing. groupfs has no idmapped mounts: 
+ * owners are mapped through the initial namespace on every kernel. */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 12, 0)
+#define GROUPFS_USERNS struct user_namespace *mnt_userns, 
+#define groupfs_init_owner(inode, dir, mode) inode_init_owner(&init_user_ns, inode, dir, mode)
+#else
+#define GROUPFS_USERNS  /* no mount user namespace */
+#define groupfs_init_owner(inode, dir, mode) inode_init_owner(inode, dir, mode)
+#endif
+
+static int groupfs_open(struct inode *inode, struct file *filp)
+{
+	struct group_dev_t *gdev = inode->i_private;
+	
+	// the inode holds the installation reference while open
+	kref_get(&gdev->kref);
+	return gfile_open(filp, gdev);
+}
+
+static const struct file_operations groupfs_fops = {
+	.owner = THIS_MODULE,
+	.open = groupfs_open,
+	.release = group_release,
+	.read = group_read,
+	.write = group_write,
+	.unlocked_ioctl = group_ioctl,
+	.flush = group_flush,
+	.mmap = group_mmap,
+	.poll = group_poll
+};
+
+static const struct inode_operations groupfs_dir_iops;
+
+static struct inode *groupfs_get_inode(struct super_block *sb, const struct inode *dir, umode_t mode)
+{
+	struct inode *inode;
+	
+	if (!(inode = new_inode(sb)))
+		return NULL;
+	
+	inode->i_ino = get_next_ino();
+	groupfs_init_owner(inode, dir, mode);
+	inode->i_atime = inode->i_mtime = inode->i_ctime = current_time(inode);
+	
+	if (S_ISDIR(mode))
+	{
+		inode->i_op = &groupfs_dir_iops;
+		inode->i_fop = &simple_dir_operations;
+		inc_nlink(inode);
+	}
+	else
+		inode->i_fop = &groupfs_fops;
+	
+	return inode;
+}
+
+// open(O_CREAT) within the mount: a new group named after the file
+static int groupfs_create(GROUPFS_USERNS struct inode *dir, struct dentry *dentry, 
+		umode_t mode, bool excl)
+{
+	struct groupfs_info_t *info = dir->i_sb->s_fs_info;
+	struct group_dev_t *gdev;
+	struct group_t *k_group;
+	struct inode *inode;
+	int err;
+	
+	if (dentry->d_name.len > sizeof(k_group->id))
+		return -ENAMETOOLONG;
+	
+	// the mount's quota, as minors are for devices
+	if (atomic_inc_return(&info->groups) > info->max_groups)
+	{
+		err = -EDQUOT;
+		goto failed_quota;
+	}
+	
+	if (!(k_group = kzalloc(sizeof(struct group_t), GFP_KERNEL_ACCOUNT)))
+	{
+		err = -ENOMEM;
+		goto failed_quota;
+	}
+	memcpy(k_group->id, dentry->d_name.name, dentry->d_name.len);
+	snprintf(k_group->devname, sizeof(k_group->devname), "%s", dentry->d_name.name);
+	
+	if ((err = gdev_create(&gdev, k_group, GFP_KERNEL_ACCOUNT)))
+	{
+		kfree(k_group);
+		goto failed_quota;
+	}
+	
+	if (!(inode = groupfs_get_inode(dir->i_sb, dir, (mode & ~S_IFMT) | S_IFREG)))
+	{
+		kref_put(&gdev->kref, gdev_release);
+		err = -ENOMEM;
+		goto failed_quota;
+	}
+	inode->i_private = gdev;
+	
+	// pinned until unlinked
+	d_instantiate(dentry, inode);
+	dget(dentry);
+	dir->i_mtime = dir->i_ctime = current_time(dir);
+	return 0;
+
+failed_quota:
+	atomic_dec(&info->groups);
+	return err;
+}
+
+// plain directories, to lay groups out hierarchically
+static int groupfs_mkdir(GROUPFS_USERNS struct inode *dir, struct dentry *dentry, umode_t mode)
+{
+	struct inode *inode;
+	
+	if (!(inode = groupfs_get_inode(dir->i_sb, dir, mode | S_IFDIR)))
+		return -ENOMEM;
+	
+	d_instantiate(dentry, inode);
+	dget(dentry);
+	inc_nlink(dir);
+	dir->i_mtime = dir->i_ctime = current_time(dir);
+	return 0;
+}
+
+static const struct inode_operations groupfs_dir_iops = {
+	.lookup = simple_lookup,
+	.create = groupfs_create,
+	.mkdir = groupfs_mkdir,
+	.unlink = simple_unlink,
+	.rmdir = simple_rmdir,
+};
+
+// the group outlives its inode as long as files are open
+static void groupfs_evict_inode(struct inode *inode)
+{
+	struct group_dev_t *gdev = inode->i_private;
+	
+	truncate_inode_pages_final(&inode->i_data);
+	clear_inode(inode);
+	if (gdev)
+	{
+		atomic_dec(&((struct groupfs_info_t*) inode->i_sb->s_fs_info)->groups);
+		kref_put(&gdev->kref, gdev_release);
+	}
+}
+
+static const struct super_operations groupfs_sops = {
+	.statfs = simple_statfs,
+	.drop_inode = generic_delete_inode,
+	.evict_inode = groupfs_evict_inode,
+};
+
+// mount options: max_groups=N, beyond groupfs_max_groups for CAP_SYS_ADMIN only
+static int groupfs_parse_options(char *data, struct groupfs_info_t *info)
+{
+	substring_t args[MAX_OPT_ARGS];
+	unsigned int max = READ_ONCE(groupfs_max_groups);
+	char *p;
+	int n;
+	
+	info->max_groups = max;
+	while ((p = strsep(&data, ",")))
+	{
+		if (!*p)
+			continue;
+		
+		switch (match_token(p, groupfs_tokens, args))
+		{
+			case GROUPFS_OPT_MAX_GROUPS:
+				if (match_int(&args[0], &n) || n <= 0)
+					return -EINVAL;
+				if ((unsigned int) n > max && !capable(CAP_SYS_ADMIN))
+					return -EPERM;
+				info->max_groups = n;
+				break;
+			
+			default:
+				return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+static int groupfs_fill_super(struct super_block *sb, void *data, int silent)
+{
+	struct groupfs_info_t *info;
+	struct inode *inode;
+	int err;
+	
+	// freed by groupfs_kill_sb, even if filling fails
+	if (!(info = kzalloc(sizeof(struct groupfs_info_t), GFP_KERNEL)))
+		return -ENOMEM;
+	atomic_set(&info->groups, 0);
+	sb->s_fs_info = info;
+	if ((err = groupfs_parse_options(data, info)))
+		return err;
+	
+	sb->s_blocksize = PAGE_SIZE;
+	sb->s_blocksize_bits = PAGE_SHIFT;
+	sb->s_magic = GROUPFS_MAGIC;
+	sb->s_op = &groupfs_sops;
+	sb->s_time_gran = 1;
+	
+	if (!(inode = groupfs_get_inode(sb, NULL, S_IFDIR | 0755)))
+		return -ENOMEM;
+	if (!(sb->s_root = d_make_root(inode)))
+		return -ENOMEM;
+	
 	return 0;
 }
 
+// every mount is a new, empty, namespace
+static struct dentry *groupfs_mount(struct file_system_type *fs_type, int flags, 
+		const char *dev_name, void *data)
+{
+	return mount_nodev(fs_type, flags, data, groupfs_fill_super);
+}
+
+static void groupfs_kill_sb(struct super_block *sb)
+{
+	struct groupfs_info_t *info = sb->s_fs_info;
+	
+	kill_litter_super(sb);
+	kfree(info);
+}
+
+static struct file_system_type groupfs_type = {
+	.owner = THIS_MODULE,
+	.name = "groupfs",
+	.mount = groupfs_mount,
+	.kill_sb = groupfs_kill_sb,
+	.fs_flags = FS_USERNS_MOUNT,
+};
+
 
 // ------------- MODULE MANAGEMENT ------------------- //
 
 static int __init initfn(void)
 {
+	struct group_dev_t *gdev;
 	struct group_t *group;
-	uint64_t hkey;
 	dev_t dev = 0;
 	int err;
 	
+	// barrier page layout
+	BUILD_BUG_ON(BARRIERS * sizeof(struct barrier_shm_t) > PAGE_SIZE);
+	BUILD_BUG_ON(sizeof(struct barrier_payload_t) != 128);
+	
 	// global variables
-	hash_init(groups_htbl);
-	spin_lock_init(&install_lock);
-	spin_lock_init(&htbl_lock);
+	if ((err = rhashtable_init(&groups_htbl, &groups_params)))
+	{
+		printk(KERN_ERR "%s: failed to create the groups hashtable.\n", KBUILD_MODNAME);
+		return err;
+	}
 	
 	// lookaside caches
 	if(!(msg_cache = kmem_cache_create("groups_msg",
@@ -840,13 +3303,35 @@ static int __init initfn(void)
 	spin_lock_init(&published_work_lock);
 	spin_lock_init(&delayed_work_lock);
 	
-	// dynamic major allocation
+	if(!(module_stats = alloc_percpu(struct group_stats_t)))
+	{
+		printk(KERN_ERR "%s: no memory for module stats.\n", KBUILD_MODNAME);
+		err = -ENOMEM;
+		goto failed_module_stats;
+	}
+	
+	// instrumented from the first group on
+	if(lock_stats)
+	{
+		if(!(module_lock_stats = __alloc_percpu(LOCK_CLASSES * sizeof(struct lock_stat_t), 
+				__alignof__(struct lock_stat_t))))
+		{
+			printk(KERN_ERR "%s: no memory for lock stats.\n", KBUILD_MODNAME);
+			err = -ENOMEM;
+			goto failed_lock_stats;
+		}
+		lock_stats_since = ktime_get_ns();
+		static_branch_enable(&lock_stats_key);
+	}
+	
+	// dynamic major allocation, further regions on demand
 	if ((err = alloc_chrdev_region(&dev, 0, range, KBUILD_MODNAME)))
 	{
 		printk(KERN_WARNING "%s: can't get major %d.\n", KBUILD_MODNAME, major);
 		goto failed_chrdevreg;
 	}
 	major = MAJOR(dev);
+	regions = 1;
 
 	// device class creation
 	if (IS_ERR(class = class_create(THIS_MODULE, "groups")))
@@ -864,22 +3349,55 @@ static int __init initfn(void)
 		goto failed_groupalloc;
 	}
 	snprintf(group->id, 32, "%s", KBUILD_MODNAME);
-	hkey = xxh64(group->id, strlen(group->id), 1);
-	if ((err = gdev_init(NULL, group, dev, hkey)))
+	lock_install();
+	err = gdev_init(&gdev, group);
+	unlock_install();
+	if (err)
 	{
 		goto failed_devreg;
 	}
 	
+	// every other group is installed through it
+	if ((err = gdev_export(gdev)))
+	{
+		printk(KERN_ERR "%s: failed to export the first group.\n", KBUILD_MODNAME);
+		goto failed_export;
+	}
+	
+	if (groupfs && (err = register_filesystem(&groupfs_type)))
+	{
+		printk(KERN_ERR "%s: failed to register groupfs.\n", KBUILD_MODNAME);
+		goto failed_fsreg;
+	}
+	
+	// debugging aid only, its failures are ignored
+	debugfs_dir = debugfs_create_dir(KBUILD_MODNAME, NULL);
+	debugfs_create_file("stats", 0444, debugfs_dir, NULL, &module_stats_fops);
+	debugfs_create_file("latency", 0644, debugfs_dir, NULL, &latency_fops);
+	debugfs_create_file("locks", 0644, debugfs_dir, NULL, &lock_stats_fops);
+	
 	return 0;
 
+failed_fsreg:
+	gdev_unexport(gdev);
+failed_export:
+	rhashtable_remove_fast(&groups_htbl, &gdev->hnode, groups_params);
+	groups--;
+	gdev_discard(gdev);
 failed_devreg:
 	kfree(group);
 failed_groupalloc:
 	class_unregister(class);
 	class_destroy(class);
 failed_classreg:
-	unregister_chrdev_region(dev, 1);
+	unregister_chrdev_region(dev, range);
 failed_chrdevreg:
+	if(lock_stats)
+		static_branch_disable(&lock_stats_key);
+	free_percpu(module_lock_stats);
+failed_lock_stats:
+	free_percpu(module_stats);
+failed_module_stats:
 	kfree(next_delayed_list);
 failed_next_delayed:
 	kfree(active_delayed_list);
@@ -896,13 +3414,23 @@ failed_group_dev_cache:
 failed_delayed_cache:
 	kmem_cache_destroy(msg_cache);
 failed_msg_cache:
+	rhashtable_destroy(&groups_htbl);
 	return err;
 }
 
 static void __exit exitfn(void)
 {
-	unsigned long bkt = 0;
-	struct group_dev_t *gdev = NULL, *gdev_prev = NULL;
+	unsigned int region;
+	
+	debugfs_remove_recursive(debugfs_dir);
+	
+	// no mount left, the module is pinned otherwise
+	if (groupfs)
+		unregister_filesystem(&groupfs_type);
+	
+	// destroy all groups, unread messages go to the garbage collector
+	rhashtable_free_and_destroy(&groups_htbl, gdev_destroy_fn, NULL);
+	idr_destroy(&minors);
 	
 	// garbage collection structures
 	flush_workqueue(groups_wq);
@@ -916,50 +3444,18 @@ static void __exit exitfn(void)
 	kfree(next_published_list);
 	kfree(active_published_list);
 	
-	// destroy all groups
-	while(gdev == NULL && bkt < HASH_SIZE(groups_htbl))
-	{
-		gdev = hlist_entry_safe((&groups_htbl[bkt])->first, struct group_dev_t, hnode);
-		// for each entry
-		while(gdev)
-		{
-			struct list_head *pos;
-			struct msg_t *msg;
-			dev_t dev = gdev->cdev.dev;
-			
-			sysfs_remove_file(&gdev->dev->kobj, &gdev->max_strg_size_attr.attr);
-			sysfs_remove_file(&gdev->dev->kobj, &gdev->max_msg_size_attr.attr);
-			cdev_del(&gdev->cdev);
-			device_destroy(class, dev);
-
-			// remove unread messages
-			list_for_each(pos, &gdev->published_list)
-			{
-				msg = container_of(pos, struct msg_t, node);
-				pos = pos->prev;
-				list_del(&msg->node);
-				vfree(msg->text);
-				kmem_cache_free(msg_cache, msg);
-			}
-
-			// delayed messages were flushed on last close syscall
-			
-			// get new reference to next gdev
-			gdev_prev = gdev;
-			gdev = hlist_entry_safe((gdev)->hnode.next, struct group_dev_t, hnode);
-			
-			kfree(gdev_prev->group);
-			kmem_cache_free(group_dev_cache, gdev_prev);
-		}
-		bkt++;
-	}
+	// group_dev_t(s) are freed after a grace period
+	rcu_barrier();
+	free_percpu(module_lock_stats);
+	free_percpu(module_stats);
 	
 	// destroy lookaside caches
 	kmem_cache_destroy(msg_cache);
 	kmem_cache_destroy(delayed_msg_cache);
 	kmem_cache_destroy(group_dev_cache);
 	
-	unregister_chrdev_region(MKDEV(major,0), range);
+	for(region = 0; region < regions; region++)
+		unregister_chrdev_region(MKDEV(major, region * range), range);
 	class_destroy(class);
 	printk(KERN_INFO "%s (maj=%d): unloaded.\n", KBUILD_MODNAME, major);
 }
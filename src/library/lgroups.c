@@ -1,10 +1,18 @@
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "groups.h"
 #include "lgroups.h"
@@ -17,6 +25,21 @@
 // udev trials before returning errors to users
 #define UDEV_TRIALS 3
 
+// barrier polls in userspace before going to sleep in kernel
+#define BARRIER_SPIN 2000
+
+_Static_assert(LGROUP_BARRIERS == BARRIERS, "lgroups.h and groups.h disagree on barriers");
+_Static_assert(LGROUP_BARRIER_TREE == BARRIER_TREE, "lgroups.h and groups.h disagree on barrier modes");
+_Static_assert(LGROUP_BARRIER_PAYLOAD_MAX == BARRIER_PAYLOAD_MAX, "lgroups.h and groups.h disagree on payloads");
+_Static_assert(LGROUP_BUFFERS_MAX == GROUP_BUFFERS_MAX, "lgroups.h and groups.h disagree on buffers");
+_Static_assert(sizeof(struct lgroup_delivery_t) == sizeof(struct group_delivery_t), 
+		"lgroups.h and groups.h disagree on deliveries");
+_Static_assert(sizeof(struct lgroup_stats_t) == sizeof(struct group_stats_t), 
+		"lgroups.h and groups.h disagree on stats");
+_Static_assert(sizeof(struct lgroup_status_t) == 
+		sizeof(struct group_status_t) - offsetof(struct group_status_t, published), 
+		"lgroups.h and groups.h disagree on status");
+
 char *udev_folder = "/dev/synch/";
 
 // file descriptor for the initial LKM group
@@ -26,8 +49,15 @@ int fd_group0 = -1;
 struct lgroup_t {
 	struct group_t __group;
 	int __fd;
+	struct barrier_shm_t *__barriers;  // NULL: not mapped yet
+	int __nobarriers;  // barrier page unavailable, barriers through ioctls only
+	struct publish_buffer_t *__buffer;  // NULL: unbuffered publications
+	struct group_status_t *__status;  // NULL: not mapped yet
+	int __nostatus;  // status page unavailable, don't map it again
 };
 
+static void publish_buffer_destroy(struct lgroup_t *lgroup);
+
 static const struct group_t EmptyGroup;
 
 struct lgroup_t* lgroup_init()
@@ -35,14 +65,35 @@ struct lgroup_t* lgroup_init()
 	struct lgroup_t *lgroup = malloc(sizeof(struct lgroup_t));
 	lgroup->__group = EmptyGroup;
 	lgroup->__fd = -1;
+	lgroup->__barriers = NULL;
+	lgroup->__nobarriers = 0;
+	lgroup->__buffer = NULL;
+	lgroup->__status = NULL;
+	lgroup->__nostatus = 0;
 	return lgroup;
 }
 
+// size of the mapping of barrier states and payloads
+static size_t barrier_map_size()
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	
+	return page + (BARRIERS * sizeof(struct barrier_payload_t) + page - 1) / page * page;
+}
+
 void lgroup_destroy(struct lgroup_t *lgroup)
 {
 	if(!lgroup)
 		return;
 	
+	// pending publications go out first
+	publish_buffer_destroy(lgroup);
+	
+	if(lgroup->__barriers)
+		munmap(lgroup->__barriers, barrier_map_size());
+	if(lgroup->__status)
+		munmap(lgroup->__status, sysconf(_SC_PAGESIZE));
+	
 	if(lgroup->__fd != -1)
 		close(lgroup->__fd);
 	
@@ -52,10 +103,9 @@ void lgroup_destroy(struct lgroup_t *lgroup)
 
 // -------------- IOCTL-RELATED OPERATIONS -------------- //
 
-int install_group(struct lgroup_t *lgroup, char *group_id)
+// opens group0, once per process
+static int open_group0()
 {
-	int res;
-	
 	// check group0
 	if(fd_group0 == -1)  // not yet opened?
 	{
@@ -68,19 +118,131 @@ int install_group(struct lgroup_t *lgroup, char *group_id)
 			return -1;
 		}
 	}
+	return 0;
+}
+
+// finalizes a previously installed lgroup
+static int lgroup_close(struct lgroup_t *lgroup)
+{
+	int res;
+	
+	publish_buffer_destroy(lgroup);
+	if(lgroup->__barriers)
+	{
+		munmap(lgroup->__barriers, barrier_map_size());
+		lgroup->__barriers = NULL;
+	}
+	lgroup->__nobarriers = 0;
+	if(lgroup->__status)
+	{
+		munmap(lgroup->__status, sysconf(_SC_PAGESIZE));
+		lgroup->__status = NULL;
+	}
+	lgroup->__nostatus = 0;
+	res = close(lgroup->__fd);
+	lgroup->__fd = -1;
+	return res;
+}
+
+// maps the read-only status page on first use, NULL if unavailable
+static struct group_status_t* status_map(struct lgroup_t *lgroup)
+{
+	struct group_status_t *page, *mapped = NULL;
 	
-	// lgroup not finalized yet
-	if(lgroup->__fd != -1)
+	if((page = __atomic_load_n(&lgroup->__status, __ATOMIC_ACQUIRE)) || 
+			__atomic_load_n(&lgroup->__nostatus, __ATOMIC_RELAXED))
+		return page;
+	
+	// right after the barrier payloads
+	page = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, 
+			lgroup->__fd, barrier_map_size());
+	if(page == MAP_FAILED)
+	{
+		__atomic_store_n(&lgroup->__nostatus, 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+	
+	// concurrent first uses: the first mapping wins
+	if(!__atomic_compare_exchange_n(&lgroup->__status, &mapped, page, 
+			0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		munmap(page, sysconf(_SC_PAGESIZE));
+		page = mapped;
+	}
+	return page;
+}
+
+// maps the barrier page and payloads on first barrier use, NULL if unavailable
+static struct barrier_shm_t* barrier_map(struct lgroup_t *lgroup)
+{
+	struct barrier_shm_t *barriers, *mapped = NULL;
+	
+	if((barriers = __atomic_load_n(&lgroup->__barriers, __ATOMIC_ACQUIRE)) || 
+			__atomic_load_n(&lgroup->__nobarriers, __ATOMIC_RELAXED))
+		return barriers;
+	
+	barriers = mmap(NULL, barrier_map_size(), PROT_READ | PROT_WRITE,
+			MAP_SHARED, lgroup->__fd, 0);
+	if(barriers == MAP_FAILED)
 	{
-		res = close(lgroup->__fd);
-		lgroup->__fd = -1;
+		__atomic_store_n(&lgroup->__nobarriers, 1, __ATOMIC_RELAXED);
+		return NULL;
 	}
 	
+	// concurrent first uses: the first mapping wins
+	if(!__atomic_compare_exchange_n(&lgroup->__barriers, &mapped, barriers, 
+			0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		munmap(barriers, barrier_map_size());
+		barriers = mapped;
+	}
+	return barriers;
+}
+
+// payload slot of barrier, mapped right after the barrier page
+static struct barrier_payload_t* barrier_payload(struct barrier_shm_t *barriers, unsigned int barrier)
+{
+	return (struct barrier_payload_t*) ((char*) barriers + sysconf(_SC_PAGESIZE)) + barrier;
+}
+
+int install_group(struct lgroup_t *lgroup, char *group_id)
+{
+	int res;
+	
+	if(open_group0())
+		return -1;
+	
+	// lgroup not finalized yet
+	if(lgroup->__fd != -1)
+		res = lgroup_close(lgroup);
+	
 	// lgroup not installed yet
 	if(lgroup->__fd == -1)
 	{
+		struct group_fd_t install = { .installed = 0 };
+		
 		strncpy(lgroup->__group.id, group_id, 32);
+		install.group = lgroup->__group;
 		
+		// INSTALL_GROUP_FD ioctl syscall, the group comes already open
+		if((lgroup->__fd = ioctl(fd_group0, INSTALL_GROUP_FD, &install)) != -1)
+		{
+			lgroup->__group = install.group;
+			res = install.installed;
+		}
+		else if(errno != ENOTTY)
+		{
+			if(errno == EDQUOT)
+				return -2;
+			
+			//perror("lgroups.install_group: INSTALL_GROUP_FD ioctl:");
+			return -3;
+		}
+	}
+	
+	// module not supporting INSTALL_GROUP_FD, through udev
+	if(lgroup->__fd == -1)
+	{
 		// INSTALL_GROUP ioctl syscall
 		if((res = ioctl(fd_group0, INSTALL_GROUP, &lgroup->__group)) < 0)
 		{
@@ -117,12 +279,99 @@ int install_group(struct lgroup_t *lgroup, char *group_id)
 				return -4-res;
 			}
 		}
+	}
+	
+	return res;
+}
+
+int install_groups(struct lgroup_t **lgroups, char **group_ids, unsigned int count)
+{
+	struct group_batch_t batch = { .count = count };
+	int res = 0;
+	
+	if(open_group0())
+		return -1;
+	
+	batch.groups = calloc(count, sizeof(struct group_t));
+	batch.fds = malloc(count * sizeof(int));
+	if(!batch.groups || !batch.fds)
+	{
+		res = -3;
+		goto out;
+	}
+	for(unsigned int i = 0; i < count; i++)
+	{
+		strncpy(batch.groups[i].id, group_ids[i], 32);
+		batch.fds[i] = -1;
+	}
+	
+	// INSTALL_GROUPS ioctl syscall, groups come already open
+	if(ioctl(fd_group0, INSTALL_GROUPS, &batch) < 0)
+	{
+		res = errno == EDQUOT ? -2 : -3;
+		
+		// results unreported, no descriptor was installed
+		if(errno == EFAULT)
+			goto out;
+	}
+	
+	// resolved groups are usable even if the batch failed midway
+	for(unsigned int i = 0; i < count; i++)
+	{
+		if(batch.fds[i] == -1)
+			continue;
 		
+		if(lgroups[i]->__fd != -1)
+			lgroup_close(lgroups[i]);
+		lgroups[i]->__group = batch.groups[i];
+		lgroups[i]->__fd = batch.fds[i];
 	}
 	
+	if(!res)
+		res = batch.installed;
+	
+out:
+	free(batch.groups);
+	free(batch.fds);
 	return res;
 }
 
+int uninstall_group(struct lgroup_t *lgroup)
+{
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// UNINSTALL_GROUP ioctl syscall, on the group itself
+	if(ioctl(lgroup->__fd, UNINSTALL_GROUP, &lgroup->__group) < 0)
+	{
+		//perror("lgroups.uninstall_group: UNINSTALL_GROUP ioctl:");
+		return errno == ENOENT ? -3 : -2;
+	}
+	
+	return 0;
+}
+
+int export_group(struct lgroup_t *lgroup)
+{
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// EXPORT_GROUP ioctl syscall, a no-op once exported
+	if(ioctl(lgroup->__fd, EXPORT_GROUP) < 0)
+	{
+		//perror("lgroups.export_group: EXPORT_GROUP ioctl:");
+		return -2;
+	}
+	
+	return 0;
+}
+
 int set_send_delay(struct lgroup_t *lgroup, unsigned int delay)
 {
 	// check if group was correctly installed
@@ -181,32 +430,29 @@ int publish_message(struct lgroup_t *lgroup, char *msg)
 	return res;
 }
 
-int deliver_message(struct lgroup_t *lgroup, char *buf, unsigned long size)
+int publish_message_n(struct lgroup_t *lgroup, const void *msg, unsigned long size)
 {
 	int res;
 	
 	// check if group was correctly installed
-	if(!lgroup->__fd == -1)
+	if(lgroup->__fd == -1)
 	{
 		return -1;
 	}
 	
-	// read syscall
-	buf[0] = '\0';
-	if((res = read(lgroup->__fd, buf, size)) < 0)
+	// write syscall
+	if((res = write(lgroup->__fd, msg, size)) < 0)
 	{
-		//fprintf(stderr, "lgroups.deliver_message.read : %s.\n", strerror(errno));
+		//fprintf(stderr, "lgroups.publish_message_n.write : %s.\n", strerror(errno));
 		return -2;
 	}
 	
 	return res;
 }
 
-
-// -------------- BARRIER OPERATIONS -------------- //
-
-int sleep_on_barrier(struct lgroup_t *lgroup)
+int deliver_message(struct lgroup_t *lgroup, char *buf, unsigned long size)
 {
+	struct group_status_t *status;
 	int res;
 	
 	// check if group was correctly installed
@@ -215,151 +461,1567 @@ int sleep_on_barrier(struct lgroup_t *lgroup)
 		return -1;
 	}
 	
-	// SLEEP_ON_BARRIER ioctl syscall
-	if((res = ioctl(lgroup->__fd, SLEEP_ON_BARRIER)) < 0)
+	// empty queue, no need to enter the kernel
+	buf[0] = '\0';
+	if((status = status_map(lgroup)) && !__atomic_load_n(&status->ready, __ATOMIC_ACQUIRE))
+		return 0;
+	
+	// read syscall
+	if((res = read(lgroup->__fd, buf, size)) < 0)
 	{
-		//fprintf(stderr, "lgroups.sleep_on_barrier.ioctl : %s.\n", strerror(errno));
+		//fprintf(stderr, "lgroups.deliver_message.read : %s.\n", strerror(errno));
 		return -2;
 	}
 	
 	return res;
 }
 
-int awake_barrier(struct lgroup_t *lgroup)
+
+int peek_message_size(struct lgroup_t *lgroup)
 {
 	int res;
 	
 	// check if group was correctly installed
-	if(!lgroup->__fd == -1)
+	if(lgroup->__fd == -1)
 	{
 		return -1;
 	}
 	
-	// AWAKE_BARRIER ioctl syscall
-	if((res = ioctl(lgroup->__fd, AWAKE_BARRIER)) < 0)
+	// PEEK_MESSAGE_SIZE ioctl syscall
+	if((res = ioctl(lgroup->__fd, PEEK_MESSAGE_SIZE)) < 0)
 	{
-		//fprintf(stderr, "lgroups.awake_barrier.ioctl : %s.\n", strerror(errno));
+		//fprintf(stderr, "lgroups.peek_message_size.ioctl : %s.\n", strerror(errno));
 		return -2;
 	}
 	
 	return res;
 }
 
-
-// -------------- SYSFS-RELATED OPERATIONS -------------- //
-
-int get_max_message_size(struct lgroup_t *lgroup, unsigned long *size)
+int wait_messages(struct lgroup_t *lgroup, const struct timespec *timeout, int flags)
 {
-	// sysfs open
-	char sys_path[100];
-	int sys_fd = 0;
-	snprintf(sys_path, 100, "/sys/class/groups/%s/max_message_size", lgroup->__group.devname);
-	if ((sys_fd = open(sys_path, O_RDONLY))==-1)
+	struct group_wait_t wait = { .flags = 0 };
+	struct group_status_t *status;
+	struct timespec now = { 0, 0 };
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
 	{
-		//fprintf(stderr, "lgroups.get_max_message_size: sysfs.open '%s': %s.\n", sys_path, strerror(errno));
-		return -2;
+		return -1;
 	}
 	
-	// sysfs read
-	int err;
-	char buf[100];
-	if((err = read(sys_fd, buf, 100)) < 0)
+	// messages already queued, no need to enter the kernel
+	if((status = status_map(lgroup)) && __atomic_load_n(&status->ready, __ATOMIC_ACQUIRE))
+		return 0;
+	
+	// relative timeouts become deadlines, as for barriers
+	if(timeout)
 	{
-		//fprintf(stderr, "lgroups.get_max_message_size: sysfs.read '%s': %s.\n", sys_path, strerror(errno));
-		return -3;
+		if(!(flags & LGROUP_ABSTIME))
+			clock_gettime(CLOCK_MONOTONIC, &now);
+		wait.flags = GROUP_WAIT_TIMED | GROUP_WAIT_ABSTIME;
+		wait.timeout = (now.tv_sec + timeout->tv_sec) * 1000000000LL 
+				+ now.tv_nsec + timeout->tv_nsec;
 	}
-	close(sys_fd);
 	
-	*size = strtoul(buf, NULL, 10);
+	// WAIT_MESSAGES ioctl syscall
+	if(ioctl(lgroup->__fd, WAIT_MESSAGES, &wait) < 0)
+	{
+		//fprintf(stderr, "lgroups.wait_messages.ioctl : %s.\n", strerror(errno));
+		return errno == ETIMEDOUT ? -3 : -2;
+	}
 	
 	return 0;
 }
 
-int set_max_message_size(struct lgroup_t *lgroup, unsigned long size)
+// reads the head message if it fits size, its size in *needed otherwise
+static int read_message(struct lgroup_t *lgroup, void *buf, unsigned long size, 
+		unsigned long *needed)
 {
-	// non root?
-	if(geteuid()!=0)
+	struct group_read_t read = { .buf = buf, .size = size, .msg_size = 0 };
+	int res;
+	
+	*needed = 0;
+	if((res = ioctl(lgroup->__fd, READ_MESSAGE, &read)) < 0 && errno == EMSGSIZE)
 	{
-		//fprintf(stderr, "lgroups.set_max_message_size: run as superuser.\n");
-		return -1;
+		*needed = read.msg_size;
+		return 0;
 	}
+	return res;
+}
+
+int deliver_message_fit(struct lgroup_t *lgroup, void *buf, unsigned long size, 
+		unsigned long *needed)
+{
+	struct group_status_t *status;
+	int res;
 	
-	// sysfs open
-	char sys_path[100];
-	int sys_fd = 0;
-	snprintf(sys_path, 100, "/sys/class/groups/%s/max_message_size", lgroup->__group.devname);
-	if ((sys_fd = open(sys_path, O_WRONLY))==-1) {
-		//fprintf(stderr, "lgroups.set_max_message_size: sysfs.open '%s': %s.\n", sys_path, strerror(errno));
-		return -3;
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
 	}
 	
-	// sysfs write
-	char buf[100];
-	sprintf(buf, "%lu", size);
-	if(!write(sys_fd, buf, strlen(buf)+1))
+	// empty queue, no need to enter the kernel
+	*needed = 0;
+	if((status = status_map(lgroup)) && !__atomic_load_n(&status->ready, __ATOMIC_ACQUIRE))
+		return 0;
+	
+	// READ_MESSAGE ioctl syscall
+	if((res = read_message(lgroup, buf, size, needed)) < 0)
 	{
-		//fprintf(stderr, "lgroups.set_max_message_size: sysfs.write '%s': %s.\n", sys_path, strerror(errno));
-		return -4;
+		//fprintf(stderr, "lgroups.deliver_message_fit.ioctl : %s.\n", strerror(errno));
+		return -2;
 	}
-	close(sys_fd);
 	
-	return 0;
+	return res;
 }
 
-int get_max_storage_size(struct lgroup_t *lgroup, unsigned long *size)
+int deliver_message_alloc(struct lgroup_t *lgroup, char **msg)
 {
-	// sysfs open
-	char sys_path[100];
-	int sys_fd = 0;
-	snprintf(sys_path, 100, "/sys/class/groups/%s/max_storage_size", lgroup->__group.devname);
-	if ((sys_fd = open(sys_path, O_RDONLY))==-1)
+	unsigned long size, needed;
+	char *buf = NULL, *tmp;
+	int res;
+	
+	*msg = NULL;
+	if((res = peek_message_size(lgroup)) <= 0)
 	{
-		//fprintf(stderr, "lgroups.get_max_storage_size: sysfs.open '%s': %s.\n", sys_path, strerror(errno));
-		return -2;
+		return res;
 	}
 	
-	// sysfs read
-	int err;
-	char buf[100];
-	if((err = read(sys_fd, buf, 100)) < 0)
+	// the head may change meanwhile, resized until a message fits
+	for(size = res;; size = needed)
 	{
-		//fprintf(stderr, "lgroups.get_max_storage_size: sysfs.read '%s': %s.\n", sys_path, strerror(errno));
-		return -3;
+		if(!(tmp = realloc(buf, size)))
+		{
+			free(buf);
+			return -3;
+		}
+		buf = tmp;
+		
+		if((res = read_message(lgroup, buf, size, &needed)) < 0)
+		{
+			//fprintf(stderr, "lgroups.deliver_message_alloc.ioctl : %s.\n", strerror(errno));
+			free(buf);
+			return -2;
+		}
+		if(!needed)
+			break;
 	}
-	close(sys_fd);
 	
-	*size = strtoul(buf, NULL, 10);
+	if(!res)
+		free(buf);
+	else
+		*msg = buf;
+	return res;
+}
+
+int deliver_message_pool(struct lgroup_t *lgroup, char **bufs, const unsigned long *sizes, 
+		unsigned int count, int *index)
+{
+	unsigned long needed;
+	unsigned int i;
+	int res;
 	
-	return 0;
+	*index = -1;
+	if((res = peek_message_size(lgroup)) <= 0)
+	{
+		return res;
+	}
+	
+	for(needed = res; needed;)
+	{
+		// best fit: the smallest buffer holding the message
+		for(*index = -1, i = 0; i < count; i++)
+			if(sizes[i] >= needed && (*index == -1 || sizes[i] < sizes[*index]))
+				*index = i;
+		if(*index == -1)
+		{
+			return -3;
+		}
+		
+		if((res = read_message(lgroup, bufs[*index], sizes[*index], &needed)) < 0)
+		{
+			//fprintf(stderr, "lgroups.deliver_message_pool.ioctl : %s.\n", strerror(errno));
+			return -2;
+		}
+	}
+	
+	if(!res)
+		*index = -1;
+	return res;
 }
 
-int set_max_storage_size(struct lgroup_t *lgroup, unsigned long size)
+int register_buffers(struct lgroup_t *lgroup, void **bufs, const unsigned long *sizes, 
+		unsigned int count)
 {
-	// non root?
-	if(geteuid()!=0)
+	struct group_buffer_t *k_bufs = NULL;
+	struct group_buffers_t reg = { .count = count };
+	unsigned int i;
+	int res = 0;
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
 	{
-		//fprintf(stderr, "lgroups.set_max_storage_size: run as superuser.\n");
 		return -1;
 	}
 	
-	// sysfs open
-	char sys_path[100];
-	int sys_fd = 0;
-	snprintf(sys_path, 100, "/sys/class/groups/%s/max_storage_size", lgroup->__group.devname);
-	if ((sys_fd = open(sys_path, O_WRONLY))==-1) {
-		//fprintf(stderr, "lgroups.set_max_storage_size: sysfs.open '%s': %s.\n", sys_path, strerror(errno));
+	if(count && !(k_bufs = malloc(count * sizeof(struct group_buffer_t))))
+	{
 		return -3;
 	}
+	for(i = 0; i < count; i++)
+	{
+		k_bufs[i].addr = bufs[i];
+		k_bufs[i].size = sizes[i];
+	}
+	reg.buffers = k_bufs;
 	
-	// sysfs write
-	char buf[100];
-	sprintf(buf, "%lu", size);
-	if(!write(sys_fd, buf, strlen(buf)+1))
+	// REGISTER_BUFFERS ioctl syscall
+	if(ioctl(lgroup->__fd, REGISTER_BUFFERS, &reg) < 0)
 	{
-		//fprintf(stderr, "lgroups.set_max_storage_size: sysfs.write '%s': %s.\n", sys_path, strerror(errno));
-		return -4;
+		//fprintf(stderr, "lgroups.register_buffers.ioctl : %s.\n", strerror(errno));
+		res = -2;
 	}
-	close(sys_fd);
 	
-	return 0;
+	free(k_bufs);
+	return res;
+}
+
+int deliver_messages(struct lgroup_t *lgroup, struct lgroup_delivery_t *deliveries, 
+		unsigned int max, int wait)
+{
+	struct group_messages_t batch = { .deliveries = (struct group_delivery_t*) deliveries, 
+			.max = max, .flags = wait ? GROUP_MESSAGES_WAIT : 0, .count = 0 };
+	int res;
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// READ_MESSAGES ioctl syscall
+	if((res = ioctl(lgroup->__fd, READ_MESSAGES, &batch)) < 0)
+	{
+		//fprintf(stderr, "lgroups.deliver_messages.ioctl : %s.\n", strerror(errno));
+		return -2;
+	}
+	
+	return res;
+}
+
+// -------------- BUFFERED PUBLICATIONS -------------- //
+
+// publications of an lgroup, flushed as a single writev
+struct publish_buffer_t {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;  // wakes the flusher up
+	pthread_t flusher;  // deadline keeper, if any
+	int stop;
+	
+	char *data;
+	unsigned long size, bytes;  // buffered, threshold
+	struct iovec *iov;
+	unsigned int count, max_count;
+	
+	unsigned int delay;  // ms, 0: no deadline
+	struct timespec deadline;  // of the oldest buffered message
+};
+
+// publishes and empties the buffer, caller holds its lock
+static int publish_buffer_flush(struct lgroup_t *lgroup)
+{
+	struct publish_buffer_t *buffer = lgroup->__buffer;
+	unsigned int i = 0, sent = 0;
+	ssize_t res;
+	int err = 0;
+	
+	// the kernel writes each iovec as a message of its own, up 
+	// to the first failing one: it is dropped, the rest goes on
+	while(i < buffer->count)
+	{
+		if((res = writev(lgroup->__fd, buffer->iov + i, buffer->count - i)) < 0)
+		{
+			//fprintf(stderr, "lgroups.flush_messages.writev : %s.\n", strerror(errno));
+			err = errno;
+			i++;
+			continue;
+		}
+		for(; res > 0; sent++)
+			res -= buffer->iov[i++].iov_len;
+	}
+	buffer->count = 0;
+	buffer->size = 0;
+	
+	if(err)
+	{
+		errno = err;
+		return -2;
+	}
+	return sent;
+}
+
+// flushes buffered messages once the oldest one's deadline expires
+static void* publish_buffer_flusher(void *arg)
+{
+	struct lgroup_t *lgroup = arg;
+	struct publish_buffer_t *buffer = lgroup->__buffer;
+	struct timespec now;
+	
+	pthread_mutex_lock(&buffer->lock);
+	while(!buffer->stop)
+	{
+		if(!buffer->count)
+		{
+			pthread_cond_wait(&buffer->cond, &buffer->lock);
+			continue;
+		}
+		
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if(now.tv_sec > buffer->deadline.tv_sec || (now.tv_sec == buffer->deadline.tv_sec && 
+				now.tv_nsec >= buffer->deadline.tv_nsec))
+			publish_buffer_flush(lgroup);
+		else
+			pthread_cond_timedwait(&buffer->cond, &buffer->lock, &buffer->deadline);
+	}
+	pthread_mutex_unlock(&buffer->lock);
+	
+	return NULL;
+}
+
+// flushes and frees the lgroup's buffer, if any
+static void publish_buffer_destroy(struct lgroup_t *lgroup)
+{
+	struct publish_buffer_t *buffer = lgroup->__buffer;
+	
+	if(!buffer)
+		return;
+	
+	pthread_mutex_lock(&buffer->lock);
+	if(buffer->count)
+		publish_buffer_flush(lgroup);
+	buffer->stop = 1;
+	pthread_cond_signal(&buffer->cond);
+	pthread_mutex_unlock(&buffer->lock);
+	
+	if(buffer->delay)
+		pthread_join(buffer->flusher, NULL);
+	
+	pthread_cond_destroy(&buffer->cond);
+	pthread_mutex_destroy(&buffer->lock);
+	free(buffer->iov);
+	free(buffer->data);
+	free(buffer);
+	lgroup->__buffer = NULL;
+}
+
+int set_publish_buffer(struct lgroup_t *lgroup, unsigned long bytes, 
+		unsigned int count, unsigned int delay)
+{
+	struct publish_buffer_t *buffer;
+	pthread_condattr_t attr;
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	if(lgroup->__buffer || !bytes || !count || count > sysconf(_SC_IOV_MAX))
+	{
+		return -2;
+	}
+	
+	if(!(buffer = calloc(1, sizeof(struct publish_buffer_t))))
+	{
+		return -3;
+	}
+	buffer->data = malloc(bytes);
+	buffer->iov = calloc(count, sizeof(struct iovec));
+	if(!buffer->data || !buffer->iov)
+	{
+		free(buffer->iov);
+		free(buffer->data);
+		free(buffer);
+		return -3;
+	}
+	buffer->bytes = bytes;
+	buffer->max_count = count;
+	buffer->delay = delay;
+	
+	// deadlines don't follow wall clock adjustments
+	pthread_mutex_init(&buffer->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&buffer->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	
+	lgroup->__buffer = buffer;
+	if(delay && pthread_create(&buffer->flusher, NULL, publish_buffer_flusher, lgroup))
+	{
+		//perror("lgroups.set_publish_buffer: pthread_create");
+		buffer->delay = 0;
+		publish_buffer_destroy(lgroup);
+		return -3;
+	}
+	
+	return 0;
+}
+
+int publish_buffered(struct lgroup_t *lgroup, const void *msg, unsigned long size)
+{
+	struct publish_buffer_t *buffer = lgroup->__buffer;
+	int res = 0;
+	
+	// check if group was correctly installed and buffered
+	if(lgroup->__fd == -1 || !buffer)
+	{
+		return -1;
+	}
+	
+	pthread_mutex_lock(&buffer->lock);
+	
+	// no room left, previous messages go first
+	if(buffer->count && buffer->size + size > buffer->bytes)
+		res = publish_buffer_flush(lgroup);
+	
+	if(size > buffer->bytes)
+	{
+		// larger than the whole buffer, straight to the group
+		if(write(lgroup->__fd, msg, size) < 0)
+		{
+			//fprintf(stderr, "lgroups.publish_buffered.write : %s.\n", strerror(errno));
+			res = -2;
+		}
+	}
+	else
+	{
+		if(!buffer->count && buffer->delay)
+		{
+			clock_gettime(CLOCK_MONOTONIC, &buffer->deadline);
+			buffer->deadline.tv_sec += buffer->delay / 1000;
+			buffer->deadline.tv_nsec += (buffer->delay % 1000) * 1000000L;
+			if(buffer->deadline.tv_nsec >= 1000000000L)
+			{
+				buffer->deadline.tv_sec++;
+				buffer->deadline.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_signal(&buffer->cond);
+		}
+		
+		memcpy(buffer->data + buffer->size, msg, size);
+		buffer->iov[buffer->count].iov_base = buffer->data + buffer->size;
+		buffer->iov[buffer->count].iov_len = size;
+		buffer->size += size;
+		buffer->count++;
+		
+		if(buffer->size >= buffer->bytes || buffer->count >= buffer->max_count)
+			res = publish_buffer_flush(lgroup);
+	}
+	
+	pthread_mutex_unlock(&buffer->lock);
+	
+	return res < 0 ? -2 : (int) size;
+}
+
+int flush_messages(struct lgroup_t *lgroup)
+{
+	struct publish_buffer_t *buffer = lgroup->__buffer;
+	int res;
+	
+	// check if group was correctly installed and buffered
+	if(lgroup->__fd == -1 || !buffer)
+	{
+		return -1;
+	}
+	
+	pthread_mutex_lock(&buffer->lock);
+	res = publish_buffer_flush(lgroup);
+	pthread_mutex_unlock(&buffer->lock);
+	
+	return res;
+}
+
+
+// -------------- BARRIER OPERATIONS -------------- //
+
+/* copies the payload of generation into buf, returns its size (0: generation 
+ * has none) or -1 if a later broadcast overwrote it */
+static int barrier_payload_read(struct barrier_payload_t *payload, 
+		unsigned int generation, void *buf, unsigned int size)
+{
+	unsigned int seq, tag, previous, n;
+	
+	// same protocol as the kernel's AWAKE_BARRIER_PAYLOAD writer
+	do {
+		while((seq = __atomic_load_n(&payload->seq, __ATOMIC_ACQUIRE)) & 1)
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+		}
+		tag = __atomic_load_n(&payload->generation, __ATOMIC_RELAXED);
+		previous = __atomic_load_n(&payload->previous, __ATOMIC_RELAXED);
+		n = __atomic_load_n(&payload->size, __ATOMIC_RELAXED);
+		if(n > BARRIER_PAYLOAD_MAX)
+			n = BARRIER_PAYLOAD_MAX;
+		if(tag == generation)
+			memcpy(buf, payload->data, n < size ? n : size);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while(__atomic_load_n(&payload->seq, __ATOMIC_RELAXED) != seq);
+	
+	// same verdict as the kernel's barrier_payload_size
+	if(tag == generation)
+		return n;
+	if((int) (tag - generation) < 0 || (int) (previous - generation) < 0)
+		return 0;
+	return -1;
+}
+
+// releases generation of barrier, unless someone else already did
+static int barrier_advance(struct barrier_shm_t *barrier, unsigned int generation)
+{
+	unsigned long long state = __atomic_load_n(&barrier->state, __ATOMIC_SEQ_CST);
+	
+	// next generation, arrivals restart from 0 (late arrivals included)
+	while(barrier_gen(state) == generation)
+	{
+		if(__atomic_compare_exchange_n(&barrier->state, &state, barrier_next(state), 
+				0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			return 1;
+	}
+	return 0;
+}
+
+// whether generation of barrier was released
+static int barrier_released(struct barrier_shm_t *barrier, unsigned int generation)
+{
+	return barrier_gen(__atomic_load_n(&barrier->state, __ATOMIC_ACQUIRE)) != generation;
+}
+
+// withdraws an arrival from generation of barrier, unless it was already released
+static int barrier_leave(struct barrier_shm_t *barrier, unsigned int generation)
+{
+	unsigned long long state = __atomic_load_n(&barrier->state, __ATOMIC_SEQ_CST);
+	
+	while(barrier_gen(state) == generation)
+	{
+		if(__atomic_compare_exchange_n(&barrier->state, &state, state-1, 
+				0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			return 1;
+	}
+	return 0;
+}
+
+// arrives on wait->barrier of the barrier page, filling its generation in: 
+// 1 if the arrival released the barrier, 0 if it has to wait for the release
+static int barrier_arrive(struct lgroup_t *lgroup, struct barrier_wait_t *wait)
+{
+	struct barrier_shm_t *barrier = &lgroup->__barriers[wait->barrier];
+	unsigned long long state;
+	unsigned int parties;
+	
+	// same protocol as the kernel's SLEEP_ON_BARRIER
+	parties = __atomic_load_n(&barrier->parties, __ATOMIC_SEQ_CST);
+	state = __atomic_add_fetch(&barrier->state, 1, __ATOMIC_SEQ_CST);
+	wait->generation = barrier_gen(state);
+	
+	// last party shall release the barrier, unless someone else just did
+	if(!parties || barrier_arrivals(state) < parties || !barrier_advance(barrier, wait->generation))
+		return 0;
+	
+	// WAKE_BARRIER ioctl syscall, only if someone sleeps in kernel
+	if(__atomic_load_n(&barrier->sleepers, __ATOMIC_SEQ_CST))
+		ioctl(lgroup->__fd, WAKE_BARRIER, wait->barrier);
+	return 1;
+}
+
+// sleeps on wait->barrier, wait carries the timeout (generation and payload are filled in)
+static int barrier_sleep(struct lgroup_t *lgroup, struct barrier_wait_t *wait)
+{
+	struct barrier_shm_t *barrier;
+	int res;
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// no barrier page, SLEEP_ON_BARRIER_TIMED ioctl syscall
+	if(!barrier_map(lgroup))
+	{
+		if((res = ioctl(lgroup->__fd, SLEEP_ON_BARRIER_TIMED, wait)) < 0)
+		{
+			//fprintf(stderr, "lgroups.sleep_on_barrier.ioctl : %s.\n", strerror(errno));
+			return errno == ETIMEDOUT ? -3 : -2;
+		}
+		return res;
+	}
+	
+	if(wait->barrier >= BARRIERS)
+	{
+		errno = EINVAL;
+		return -2;
+	}
+	barrier = &lgroup->__barriers[wait->barrier];
+	
+	if(barrier_arrive(lgroup, wait))
+	{
+		wait->payload_size = 0;
+		return LGROUP_BARRIER_SERIAL_THREAD;
+	}
+	
+	// release may be close, spin for a while
+	for(int i = 0; i < BARRIER_SPIN; i++)
+	{
+		if(barrier_released(barrier, wait->generation))
+			goto released;
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+	
+	// WAIT_ON_BARRIER ioctl syscall
+	if(ioctl(lgroup->__fd, WAIT_ON_BARRIER, wait) < 0)
+	{
+		int err = errno;
+		
+		// not released yet: leave the barrier
+		if(barrier_leave(barrier, wait->generation))
+		{
+			//fprintf(stderr, "lgroups.sleep_on_barrier.ioctl : %s.\n", strerror(err));
+			errno = err;
+			return err == ETIMEDOUT ? -3 : -2;
+		}
+	}
+	
+released:
+	if(wait->payload)
+	{
+		res = barrier_payload_read(barrier_payload(lgroup->__barriers, wait->barrier), 
+				wait->generation + 1, wait->payload, wait->payload_size);
+		
+		// released, but the payload is lost
+		wait->payload_size = res < 0 ? 0 : res;
+		if(res < 0)
+		{
+			errno = EAGAIN;
+			return -2;
+		}
+	}
+	
+	return 0;
+}
+
+int sleep_on_barrier(struct lgroup_t *lgroup)
+{
+	return sleep_on_barrier_id(lgroup, 0);
+}
+
+int sleep_on_barrier_id(struct lgroup_t *lgroup, unsigned int barrier)
+{
+	struct barrier_wait_t wait = { .barrier = barrier, .flags = 0 };
+	
+	return barrier_sleep(lgroup, &wait);
+}
+
+int sleep_on_barrier_timed(struct lgroup_t *lgroup, unsigned int barrier,
+		const struct timespec *timeout, int flags)
+{
+	struct barrier_wait_t wait = { .barrier = barrier, 
+			.flags = BARRIER_WAIT_TIMED | BARRIER_WAIT_ABSTIME };
+	struct timespec now = { 0, 0 };
+	
+	// relative timeouts become deadlines, so that restarts don't extend them
+	if(!(flags & LGROUP_ABSTIME))
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	wait.timeout = (now.tv_sec + timeout->tv_sec) * 1000000000LL 
+			+ now.tv_nsec + timeout->tv_nsec;
+	
+	return barrier_sleep(lgroup, &wait);
+}
+
+int sleep_on_barrier_payload(struct lgroup_t *lgroup, unsigned int barrier,
+		void *payload, unsigned int *size)
+{
+	struct barrier_wait_t wait = { .barrier = barrier, .flags = 0, 
+			.payload = payload, .payload_size = *size };
+	int res;
+	
+	if((res = barrier_sleep(lgroup, &wait)) >= 0)
+		*size = wait.payload_size;
+	
+	return res;
+}
+
+int awake_barrier(struct lgroup_t *lgroup)
+{
+	return awake_barrier_id(lgroup, 0);
+}
+
+int awake_barrier_id(struct lgroup_t *lgroup, unsigned int id)
+{
+	struct barrier_shm_t *barrier;
+	unsigned long long state;
+	int res;
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// no barrier page, AWAKE_BARRIER_ID ioctl syscall
+	if(!barrier_map(lgroup))
+	{
+		if((res = ioctl(lgroup->__fd, AWAKE_BARRIER_ID, id)) < 0)
+		{
+			//fprintf(stderr, "lgroups.awake_barrier.ioctl : %s.\n", strerror(errno));
+			return -2;
+		}
+		return res;
+	}
+	
+	if(id >= BARRIERS)
+	{
+		errno = EINVAL;
+		return -2;
+	}
+	barrier = &lgroup->__barriers[id];
+	
+	// no one sleeping, nothing to release
+	state = __atomic_load_n(&barrier->state, __ATOMIC_SEQ_CST);
+	if(!barrier_arrivals(state))
+		return 2;
+	
+	// release, same protocol as the kernel's AWAKE_BARRIER
+	barrier_advance(barrier, barrier_gen(state));
+	
+	// WAKE_BARRIER ioctl syscall, only if someone sleeps in kernel
+	if(__atomic_load_n(&barrier->sleepers, __ATOMIC_SEQ_CST)
+			&& ioctl(lgroup->__fd, WAKE_BARRIER, id) < 0)
+	{
+		//fprintf(stderr, "lgroups.awake_barrier.ioctl : %s.\n", strerror(errno));
+		return -2;
+	}
+	
+	return 0;
+}
+
+int awake_barrier_payload(struct lgroup_t *lgroup, unsigned int barrier,
+		const void *payload, unsigned int size)
+{
+	struct barrier_awake_t awake = { .barrier = barrier, .size = size, .payload = payload };
+	int res;
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// AWAKE_BARRIER_PAYLOAD ioctl syscall, payload and release in one go
+	if((res = ioctl(lgroup->__fd, AWAKE_BARRIER_PAYLOAD, &awake)) < 0)
+	{
+		//fprintf(stderr, "lgroups.awake_barrier_payload.ioctl : %s.\n", strerror(errno));
+		return -2;
+	}
+	
+	return res;
+}
+
+int set_barrier_parties(struct lgroup_t *lgroup, unsigned int barrier, unsigned int parties)
+{
+	struct barrier_conf_t conf = { .barrier = barrier, .parties = parties };
+	int res;
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// SET_BARRIER_PARTIES ioctl syscall
+	if((res = ioctl(lgroup->__fd, SET_BARRIER_PARTIES, &conf)) < 0)
+	{
+		//fprintf(stderr, "lgroups.set_barrier_parties.ioctl : %s.\n", strerror(errno));
+		return -2;
+	}
+	
+	return res;
+}
+
+int set_barrier_mode(struct lgroup_t *lgroup, unsigned int barrier, unsigned int mode)
+{
+	struct barrier_conf_t conf = { .barrier = barrier, .mode = mode };
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// SET_BARRIER_MODE ioctl syscall
+	if(ioctl(lgroup->__fd, SET_BARRIER_MODE, &conf) < 0)
+	{
+		//fprintf(stderr, "lgroups.set_barrier_mode.ioctl : %s.\n", strerror(errno));
+		return -2;
+	}
+	
+	return 0;
+}
+
+
+// -------------- CONFIGURATION OPERATIONS -------------- //
+
+int get_group_config(struct lgroup_t *lgroup, struct lgroup_config_t *config)
+{
+	struct group_config_t k_config;
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// GET_CONFIG ioctl syscall, one snapshot of all parameters
+	if(ioctl(lgroup->__fd, GET_CONFIG, &k_config) < 0)
+	{
+		//fprintf(stderr, "lgroups.get_group_config.ioctl : %s.\n", strerror(errno));
+		return -2;
+	}
+	
+	config->max_message_size = k_config.max_message_size;
+	config->max_storage_size = k_config.max_storage_size;
+	config->delay = k_config.delay;
+	config->size = k_config.size;
+	
+	return 0;
+}
+
+// updates the masked parameters at once
+static int config_update(struct lgroup_t *lgroup, unsigned int mask, 
+		const struct lgroup_config_t *config)
+{
+	struct group_config_t k_config = { .mask = mask, .delay = config->delay, 
+			.max_message_size = config->max_message_size, 
+			.max_storage_size = config->max_storage_size };
+	
+	return ioctl(lgroup->__fd, SET_CONFIG, &k_config);
+}
+
+int set_group_config(struct lgroup_t *lgroup, const struct lgroup_config_t *config)
+{
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// SET_CONFIG ioctl syscall
+	if(config_update(lgroup, GROUP_CONFIG_ALL, config) < 0)
+	{
+		//fprintf(stderr, "lgroups.set_group_config.ioctl : %s.\n", strerror(errno));
+		return -2;
+	}
+	
+	return 0;
+}
+
+// reads a sysfs attribute, modules predating GET_CONFIG
+static int sysfs_get(struct lgroup_t *lgroup, const char *attr, unsigned long *size)
+{
+	// sysfs attributes are created on demand
+	if(export_group(lgroup))
+	{
+		return -2;
+	}
+	
+	// sysfs open
+	char sys_path[100];
+	int sys_fd = 0;
+	snprintf(sys_path, 100, "/sys/class/groups/%s/%s", lgroup->__group.devname, attr);
+	if ((sys_fd = open(sys_path, O_RDONLY))==-1)
+	{
+		//fprintf(stderr, "lgroups.sysfs_get: sysfs.open '%s': %s.\n", sys_path, strerror(errno));
+		return -2;
+	}
+	
+	// sysfs read
+	int err;
+	char buf[100];
+	if((err = read(sys_fd, buf, 99)) < 0)
+	{
+		//fprintf(stderr, "lgroups.sysfs_get: sysfs.read '%s': %s.\n", sys_path, strerror(errno));
+		close(sys_fd);
+		return -3;
+	}
+	close(sys_fd);
+	buf[err] = '\0';
+	
+	*size = strtoul(buf, NULL, 10);
+	
+	return 0;
+}
+
+// writes a sysfs attribute, modules predating SET_CONFIG
+static int sysfs_set(struct lgroup_t *lgroup, const char *attr, unsigned long size)
+{
+	// sysfs attributes are created on demand
+	if(export_group(lgroup))
+	{
+		return -3;
+	}
+	
+	// sysfs open
+	char sys_path[100];
+	int sys_fd = 0;
+	snprintf(sys_path, 100, "/sys/class/groups/%s/%s", lgroup->__group.devname, attr);
+	if ((sys_fd = open(sys_path, O_WRONLY))==-1) {
+		//fprintf(stderr, "lgroups.sysfs_set: sysfs.open '%s': %s.\n", sys_path, strerror(errno));
+		return -3;
+	}
+	
+	// sysfs write
+	char buf[100];
+	sprintf(buf, "%lu", size);
+	if(write(sys_fd, buf, strlen(buf)+1) <= 0)
+	{
+		//fprintf(stderr, "lgroups.sysfs_set: sysfs.write '%s': %s.\n", sys_path, strerror(errno));
+		close(sys_fd);
+		return -4;
+	}
+	close(sys_fd);
+	
+	return 0;
+}
+
+int get_max_message_size(struct lgroup_t *lgroup, unsigned long *size)
+{
+	struct lgroup_config_t config;
+	int res;
+	
+	if((res = get_group_config(lgroup, &config)) == -2 && errno == ENOTTY)
+		return sysfs_get(lgroup, "max_message_size", size);
+	if(!res)
+		*size = config.max_message_size;
+	
+	return res;
+}
+
+int set_max_message_size(struct lgroup_t *lgroup, unsigned long size)
+{
+	struct lgroup_config_t config = { .max_message_size = size };
+	
+	// non root?
+	if(geteuid()!=0)
+	{
+		//fprintf(stderr, "lgroups.set_max_message_size: run as superuser.\n");
+		return -1;
+	}
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -2;
+	}
+	
+	if(config_update(lgroup, GROUP_CONFIG_MAX_MESSAGE_SIZE, &config) < 0)
+	{
+		if(errno == ENOTTY)
+			return sysfs_set(lgroup, "max_message_size", size);
+		//fprintf(stderr, "lgroups.set_max_message_size.ioctl : %s.\n", strerror(errno));
+		return -4;
+	}
+	
+	return 0;
+}
+
+int get_max_storage_size(struct lgroup_t *lgroup, unsigned long *size)
+{
+	struct lgroup_config_t config;
+	int res;
+	
+	if((res = get_group_config(lgroup, &config)) == -2 && errno == ENOTTY)
+		return sysfs_get(lgroup, "max_storage_size", size);
+	if(!res)
+		*size = config.max_storage_size;
+	
+	return res;
+}
+
+int set_max_storage_size(struct lgroup_t *lgroup, unsigned long size)
+{
+	struct lgroup_config_t config = { .max_storage_size = size };
+	
+	// non root?
+	if(geteuid()!=0)
+	{
+		//fprintf(stderr, "lgroups.set_max_storage_size: run as superuser.\n");
+		return -1;
+	}
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -2;
+	}
+	
+	if(config_update(lgroup, GROUP_CONFIG_MAX_STORAGE_SIZE, &config) < 0)
+	{
+		if(errno == ENOTTY)
+			return sysfs_set(lgroup, "max_storage_size", size);
+		//fprintf(stderr, "lgroups.set_max_storage_size.ioctl : %s.\n", strerror(errno));
+		return -4;
+	}
+	
+	return 0;
+}
+
+int get_group_stats(struct lgroup_t *lgroup, struct lgroup_stats_t *stats)
+{
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// GET_STATS ioctl syscall, same layout as group_stats_t
+	if(ioctl(lgroup->__fd, GET_STATS, stats) < 0)
+	{
+		//fprintf(stderr, "lgroups.get_group_stats.ioctl : %s.\n", strerror(errno));
+		return -2;
+	}
+	
+	return 0;
+}
+
+int get_group_status(struct lgroup_t *lgroup, struct lgroup_status_t *status)
+{
+	struct group_status_t *page;
+	unsigned int seq;
+	
+	// check if group was correctly installed
+	if(lgroup->__fd == -1)
+	{
+		return -1;
+	}
+	
+	// read-only status page, mapped on first use
+	if(!(page = status_map(lgroup)))
+	{
+		//fprintf(stderr, "lgroups.get_group_status.mmap : %s.\n", strerror(errno));
+		errno = ENODEV;
+		return -2;
+	}
+	
+	// same protocol as the kernel's status writers
+	do {
+		while((seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE)) & 1)
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+		}
+		status->published = __atomic_load_n(&page->published, __ATOMIC_RELAXED);
+		status->delivered = __atomic_load_n(&page->delivered, __ATOMIC_RELAXED);
+		status->queued = __atomic_load_n(&page->queued, __ATOMIC_RELAXED);
+		status->size = __atomic_load_n(&page->size, __ATOMIC_RELAXED);
+		status->delayed = __atomic_load_n(&page->delayed, __ATOMIC_RELAXED);
+		status->sleepers = __atomic_load_n(&page->sleepers, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while(__atomic_load_n(&page->seq, __ATOMIC_RELAXED) != seq);
+	
+	return 0;
+}
+
+// -------------- ASYNCHRONOUS OPERATIONS -------------- //
+
+// a submitted operation, its completion reaped or passed to callback
+struct async_op_t {
+	struct lgroup_completion_t completion;
+	lgroup_callback_t callback;
+	unsigned int generation;  // barrier sleeps: the generation arrived on
+	struct async_op_t *next;
+};
+
+struct lgroup_async_t {
+	pthread_mutex_t lock;
+	pthread_cond_t submitted;  // wakes workers up
+	pthread_cond_t completed;  // wakes reapers up
+	
+	struct async_op_t *head, *tail;  // submission queue, FIFO
+	struct async_op_t *done_head, *done_tail;  // completion queue, FIFO
+	struct async_op_t *parked_head, *parked_tail;  // waiting sleeps and deliveries, oldest first
+	int sweeping;  // a worker is checking the parked operations, or polling their groups
+	int wakefd;  // eventfd, interrupts the sweeper's poll
+	unsigned int idle;  // workers waiting for submissions
+	unsigned int inflight;  // submitted, not completed yet
+	int stop;
+	
+	unsigned int threads;
+	pthread_t *tids;
+};
+
+// appends op to a FIFO list
+static void async_append(struct async_op_t **head, struct async_op_t **tail, struct async_op_t *op)
+{
+	op->next = NULL;
+	if(*tail)
+		(*tail)->next = op;
+	else
+		*head = op;
+	*tail = op;
+}
+
+// interrupts the sweeper's poll
+static void async_notify(struct lgroup_async_t *async)
+{
+	uint64_t one = 1;
+	
+	if(write(async->wakefd, &one, sizeof(one)) != sizeof(one))
+	{
+		//perror("lgroups.async_notify: write");
+	}
+}
+
+/* Runs an operation as its synchronous counterpart would, 1 if it has 
+ * to wait: a delivery finding the queue empty, or a barrier sleep that 
+ * arrived. Those don't hold a worker, they are parked for async_sweep. */
+static int async_run(struct async_op_t *op)
+{
+	struct lgroup_completion_t *c = &op->completion;
+	struct lgroup_t *lgroup = c->lgroup;
+	struct barrier_wait_t wait = { .barrier = c->barrier };
+	
+	errno = 0;
+	switch(c->op)
+	{
+		case LGROUP_ASYNC_PUBLISH:
+			c->res = publish_message_n(lgroup, c->buf, c->size);
+			break;
+		
+		case LGROUP_ASYNC_DELIVER:
+			if(!(c->res = deliver_message(lgroup, c->buf, c->size)))
+				return 1;
+			break;
+		
+		case LGROUP_ASYNC_BARRIER:
+			// no barrier page: a blocking sleep
+			if(lgroup->__fd == -1 || !barrier_map(lgroup) || c->barrier >= BARRIERS)
+			{
+				c->res = sleep_on_barrier_id(lgroup, c->barrier);
+				break;
+			}
+			if(barrier_arrive(lgroup, &wait))
+			{
+				c->res = LGROUP_BARRIER_SERIAL_THREAD;
+				break;
+			}
+			op->generation = wait.generation;
+			return 1;
+	}
+	c->err = c->res < 0 ? errno : 0;
+	return 0;
+}
+
+/* Parks an operation that has to wait, called locked. Sleeps watch their 
+ * barrier, so that poll() on the group reports its release: the module 
+ * keeps the oldest generation watched. -1 if it can't watch barriers. */
+static int async_park(struct lgroup_async_t *async, struct async_op_t *op)
+{
+	struct lgroup_completion_t *c = &op->completion;
+	struct barrier_wait_t watch = { .barrier = c->barrier, .generation = op->generation };
+	
+	// WATCH_BARRIER ioctl syscall
+	if(c->op == LGROUP_ASYNC_BARRIER && ioctl(c->lgroup->__fd, WATCH_BARRIER, &watch) < 0)
+		return -1;
+	
+	async_append(&async->parked_head, &async->parked_tail, op);
+	if(async->sweeping)  // not among the polled groups yet
+		async_notify(async);
+	else
+		pthread_cond_signal(&async->submitted);
+	return 0;
+}
+
+// sleeps in kernel until op's barrier is released, if the module can't watch it
+static void async_block(struct async_op_t *op)
+{
+	struct lgroup_completion_t *c = &op->completion;
+	struct barrier_wait_t wait = { .barrier = c->barrier, .generation = op->generation };
+	
+	// WAIT_ON_BARRIER ioctl syscall
+	c->res = c->err = 0;
+	if(ioctl(c->lgroup->__fd, WAIT_ON_BARRIER, &wait) < 0 && 
+			barrier_leave(&c->lgroup->__barriers[c->barrier], op->generation))
+	{
+		c->res = -2;
+		c->err = errno;
+	}
+}
+
+// watches lgroup's barrier for its oldest parked sleep, if any is left, called locked
+static void async_rewatch(struct lgroup_async_t *async, struct lgroup_t *lgroup, unsigned int barrier)
+{
+	struct barrier_wait_t watch = { .barrier = barrier, .flags = BARRIER_WATCH_SET };
+	struct async_op_t *op;
+	
+	for(op = async->parked_head; op; op = op->next)
+	{
+		if(op->completion.op == LGROUP_ASYNC_BARRIER && op->completion.lgroup == lgroup && 
+				op->completion.barrier == barrier)
+		{
+			// WATCH_BARRIER ioctl syscall
+			watch.generation = op->generation;
+			ioctl(lgroup->__fd, WATCH_BARRIER, &watch);
+			return;
+		}
+	}
+	
+	// UNWATCH_BARRIER ioctl syscall
+	ioctl(lgroup->__fd, UNWATCH_BARRIER, barrier);
+}
+
+// hands a completion to its callback or to the completion queue
+static void async_complete(struct lgroup_async_t *async, struct async_op_t *op)
+{
+	if(op->callback)
+	{
+		op->callback(&op->completion);
+		free(op);
+		op = NULL;
+	}
+	
+	pthread_mutex_lock(&async->lock);
+	if(op)
+		async_append(&async->done_head, &async->done_tail, op);
+	async->inflight--;
+	pthread_cond_broadcast(&async->completed);
+	pthread_mutex_unlock(&async->lock);
+}
+
+/* Completes the parked operations taken off the pool (called unlocked): 
+ * released sleeps, and deliveries finding a message. If none is done, 
+ * polls the parked groups until a watched barrier is released or a 
+ * message is queued, parks and submissions needing the worker interrupt 
+ * it. On stop, waiting operations are withdrawn (ECANCELED). */
+static void async_sweep(struct lgroup_async_t *async, struct async_op_t *parked, int stop)
+{
+	struct async_op_t *op, *prev, *kept = NULL, *kept_tail = NULL, *done = NULL, *done_tail = NULL;
+	struct lgroup_completion_t *c;
+	struct pollfd *fds = NULL;
+	unsigned int n = 0;
+	uint64_t count;
+	int waiting;
+	
+	while((op = parked))
+	{
+		parked = op->next;
+		c = &op->completion;
+		
+		if(c->op == LGROUP_ASYNC_DELIVER)
+		{
+			waiting = !(c->res = deliver_message(c->lgroup, c->buf, c->size));
+			c->err = c->res < 0 ? errno : 0;
+		}
+		else
+		{
+			waiting = !barrier_released(&c->lgroup->__barriers[c->barrier], op->generation);
+			c->res = c->err = 0;
+		}
+		
+		if(waiting && !stop)
+		{
+			async_append(&kept, &kept_tail, op);
+			n++;
+			continue;
+		}
+		
+		// withdrawn, sleeps leave their barrier unless released meanwhile
+		if(waiting && (c->op == LGROUP_ASYNC_DELIVER || 
+				barrier_leave(&c->lgroup->__barriers[c->barrier], op->generation)))
+		{
+			c->res = -2;
+			c->err = ECANCELED;
+		}
+		async_append(&done, &done_tail, op);
+	}
+	
+	// nothing done: the groups to poll, and the pool's eventfd
+	if(kept && !done && (fds = malloc((n + 1) * sizeof(struct pollfd))))
+	{
+		for(n = 0, op = kept; op; op = op->next, n++)
+		{
+			fds[n].fd = op->completion.lgroup->__fd;
+			fds[n].events = op->completion.op == LGROUP_ASYNC_DELIVER ? POLLIN : POLLPRI;
+		}
+		fds[n].fd = async->wakefd;
+		fds[n].events = POLLIN;
+	}
+	
+	// kept ones are the oldest
+	pthread_mutex_lock(&async->lock);
+	if(kept)
+	{
+		kept_tail->next = async->parked_head;
+		if(!async->parked_head)
+			async->parked_tail = kept_tail;
+		async->parked_head = kept;
+	}
+	
+	// completed sleeps hand their watch over, once per barrier
+	for(op = done; op; op = op->next)
+	{
+		if(op->completion.op != LGROUP_ASYNC_BARRIER)
+			continue;
+		for(prev = done; prev != op; prev = prev->next)
+		{
+			if(prev->completion.op == LGROUP_ASYNC_BARRIER && 
+					prev->completion.lgroup == op->completion.lgroup && 
+					prev->completion.barrier == op->completion.barrier)
+				break;
+		}
+		if(prev == op)
+			async_rewatch(async, op->completion.lgroup, op->completion.barrier);
+	}
+	pthread_mutex_unlock(&async->lock);
+	
+	// poll syscall, still sweeping: parks and submissions notify
+	if(fds)
+	{
+		if(poll(fds, n + 1, -1) > 0 && (fds[n].revents & POLLIN) && 
+				read(async->wakefd, &count, sizeof(count)) < 0)
+		{
+			//perror("lgroups.async_sweep: read");
+		}
+		free(fds);
+	}
+	
+	pthread_mutex_lock(&async->lock);
+	async->sweeping = 0;
+	if(async->stop)  // workers waiting for the withdrawals
+		pthread_cond_broadcast(&async->submitted);
+	pthread_mutex_unlock(&async->lock);
+	
+	while((op = done))
+	{
+		done = op->next;
+		async_complete(async, op);
+	}
+}
+
+static void* async_worker(void *arg)
+{
+	struct lgroup_async_t *async = arg;
+	struct async_op_t *op;
+	int stop;
+	
+	pthread_mutex_lock(&async->lock);
+	for(;;)
+	{
+		// the queue is drained before stopping, then parked operations are withdrawn
+		while(!async->head && !(async->parked_head && !async->sweeping) && !async->stop)
+		{
+			async->idle++;
+			pthread_cond_wait(&async->submitted, &async->lock);
+			async->idle--;
+		}
+		
+		if((op = async->head))
+		{
+			if(!(async->head = op->next))
+				async->tail = NULL;
+			pthread_mutex_unlock(&async->lock);
+			
+			if(async_run(op))
+			{
+				pthread_mutex_lock(&async->lock);
+				if(!async_park(async, op))
+					continue;
+				pthread_mutex_unlock(&async->lock);
+				async_block(op);
+			}
+			async_complete(async, op);
+		}
+		else if(async->parked_head && !async->sweeping)
+		{
+			op = async->parked_head;
+			async->parked_head = async->parked_tail = NULL;
+			async->sweeping = 1;
+			stop = async->stop;
+			pthread_mutex_unlock(&async->lock);
+			
+			async_sweep(async, op, stop);
+		}
+		else if(async->stop && !async->sweeping)
+			break;
+		else  // stopping, the sweeper withdraws the rest
+		{
+			pthread_cond_wait(&async->submitted, &async->lock);
+			continue;
+		}
+		
+		pthread_mutex_lock(&async->lock);
+	}
+	pthread_mutex_unlock(&async->lock);
+	
+	return NULL;
+}
+
+struct lgroup_async_t* lgroup_async_init(unsigned int threads)
+{
+	struct lgroup_async_t *async;
+	
+	if(!threads || !(async = calloc(1, sizeof(struct lgroup_async_t))))
+		return NULL;
+	if(!(async->tids = calloc(threads, sizeof(pthread_t))))
+	{
+		free(async);
+		return NULL;
+	}
+	if((async->wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1)
+	{
+		//perror("lgroups.lgroup_async_init: eventfd");
+		free(async->tids);
+		free(async);
+		return NULL;
+	}
+	
+	pthread_mutex_init(&async->lock, NULL);
+	pthread_cond_init(&async->submitted, NULL);
+	pthread_cond_init(&async->completed, NULL);
+	
+	for(async->threads = 0; async->threads < threads; async->threads++)
+	{
+		if(pthread_create(&async->tids[async->threads], NULL, async_worker, async))
+		{
+			//perror("lgroups.lgroup_async_init: pthread_create");
+			lgroup_async_destroy(async);
+			return NULL;
+		}
+	}
+	
+	return async;
+}
+
+void lgroup_async_destroy(struct lgroup_async_t *async)
+{
+	struct async_op_t *op;
+	unsigned int i;
+	
+	if(!async)
+		return;
+	
+	pthread_mutex_lock(&async->lock);
+	async->stop = 1;
+	pthread_cond_broadcast(&async->submitted);
+	if(async->sweeping)
+		async_notify(async);
+	pthread_mutex_unlock(&async->lock);
+	
+	for(i = 0; i < async->threads; i++)
+		pthread_join(async->tids[i], NULL);
+	
+	// unreaped completions
+	while((op = async->done_head))
+	{
+		async->done_head = op->next;
+		free(op);
+	}
+	
+	pthread_cond_destroy(&async->completed);
+	pthread_cond_destroy(&async->submitted);
+	pthread_mutex_destroy(&async->lock);
+	close(async->wakefd);
+	free(async->tids);
+	free(async);
+}
+
+// queues an operation to the workers
+static int async_submit(struct lgroup_async_t *async, struct lgroup_completion_t *c, 
+		lgroup_callback_t callback)
+{
+	struct async_op_t *op;
+	
+	if(!(op = malloc(sizeof(struct async_op_t))))
+	{
+		return -1;
+	}
+	op->completion = *c;
+	op->callback = callback;
+	op->next = NULL;
+	
+	pthread_mutex_lock(&async->lock);
+	if(async->stop)
+	{
+		pthread_mutex_unlock(&async->lock);
+		free(op);
+		return -2;
+	}
+	if(async->tail)
+		async->tail->next = op;
+	else
+		async->head = op;
+	async->tail = op;
+	async->inflight++;
+	pthread_cond_signal(&async->submitted);
+	if(!async->idle && async->sweeping)  // the sweeper may be the only worker
+		async_notify(async);
+	pthread_mutex_unlock(&async->lock);
+	
+	return 0;
+}
+
+int async_publish(struct lgroup_async_t *async, struct lgroup_t *lgroup, 
+		const void *msg, unsigned long size, lgroup_callback_t callback, void *user_data)
+{
+	struct lgroup_completion_t c = { .lgroup = lgroup, .op = LGROUP_ASYNC_PUBLISH, 
+			.buf = (void*) msg, .size = size, .user_data = user_data };
+	
+	return async_submit(async, &c, callback);
+}
+
+int async_deliver(struct lgroup_async_t *async, struct lgroup_t *lgroup, 
+		char *buf, unsigned long size, lgroup_callback_t callback, void *user_data)
+{
+	struct lgroup_completion_t c = { .lgroup = lgroup, .op = LGROUP_ASYNC_DELIVER, 
+			.buf = buf, .size = size, .user_data = user_data };
+	
+	return async_submit(async, &c, callback);
+}
+
+int async_sleep_on_barrier(struct lgroup_async_t *async, struct lgroup_t *lgroup, 
+		unsigned int barrier, lgroup_callback_t callback, void *user_data)
+{
+	struct lgroup_completion_t c = { .lgroup = lgroup, .op = LGROUP_ASYNC_BARRIER, 
+			.barrier = barrier, .user_data = user_data };
+	
+	return async_submit(async, &c, callback);
+}
+
+int async_reap(struct lgroup_async_t *async, struct lgroup_completion_t *completions, 
+		unsigned int max, int wait)
+{
+	struct async_op_t *op;
+	unsigned int n = 0;
+	
+	pthread_mutex_lock(&async->lock);
+	
+	// waiting is pointless once nothing is in flight
+	while(wait && !async->done_head && async->inflight)
+		pthread_cond_wait(&async->completed, &async->lock);
+	
+	while(n < max && (op = async->done_head))
+	{
+		if(!(async->done_head = op->next))
+			async->done_tail = NULL;
+		completions[n++] = op->completion;
+		free(op);
+	}
+	
+	pthread_mutex_unlock(&async->lock);
+	
+	return n;
 }
@@ -0,0 +1,141 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lgroups.h"
+#include "utils.h"
+
+#define ROUNDS 20  // releases per run
+#define SETTLE 100  // ms, to let all sleepers reach the kernel
+
+static int load;  // sleepers amount
+static int tree;  // barrier mode
+
+static struct lgroup_t *group;  // synchronization group
+static struct timespec *woken;  // per sleeper, last wake-up time
+
+static FILE* f_data;
+
+
+static void* sleeper(void *arg)
+{
+	int i = *((int*) arg);
+	
+	for(int r = 0; r < ROUNDS; r++)
+	{
+		if(sleep_on_barrier(group) < 0)
+		{
+			perror("Sleep on barrier");
+			exit(EXIT_FAILURE);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &woken[i]);
+	}
+	
+	free(arg);
+	return 0;
+}
+
+static double diff_us(struct timespec *a, struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) * 1e6 + (b->tv_nsec - a->tv_nsec) / 1e3;
+}
+
+int main(int argc, char** argv)
+{
+	struct timespec release;
+	double total = 0;
+	pthread_t* tid;
+	int err;
+
+	if(argc<4)
+	{
+		printf("PARAMETERS: arg1=sleepers, arg2=flat|tree, arg3=group_id.\n");
+		exit(EXIT_FAILURE);
+	}
+	
+	// parsing parameters
+	load = atoi(argv[1]);
+	tree = !strcmp(argv[2], "tree");
+	
+	// installing benchmark group
+	group = lgroup_init();
+	
+	if(install_group(group, argv[3]) < 0)
+	{
+		perror("Failed installing group");
+		goto error;
+	}
+	
+	// the main thread is the last party: its arrival releases the sleepers
+	if(set_barrier_mode(group, 0, tree ? LGROUP_BARRIER_TREE : LGROUP_BARRIER_FLAT) < 0
+			|| set_barrier_parties(group, 0, load + 1) < 0)
+	{
+		perror("Configure barrier");
+		goto error;
+	}
+	
+	if (!(f_data = fopen("data/barrier_release.data", "a")))
+	{
+		perror("Open barrier_release.data");
+		goto error;
+	}
+	
+	tid = calloc(load, sizeof(pthread_t));
+	woken = calloc(load, sizeof(struct timespec));
+	
+	// spawn sleepers
+	for (int i=0; i<load; i++)
+	{
+		int* j = malloc(sizeof(int)); 
+		*j = i;
+		
+		if((err = pthread_create(&(tid[i]), NULL, &sleeper, j)))
+			printf("Can't create thread %d: %s.\n", i, strerror(err));
+	}
+	
+	for(int r = 0; r < ROUNDS; r++)
+	{
+		msleep(SETTLE);
+		
+		// release, then wait for the last sleeper to wake up
+		clock_gettime(CLOCK_MONOTONIC, &release);
+		if(sleep_on_barrier(group) < 0)
+		{
+			perror("Release barrier");
+			goto error;
+		}
+		msleep(SETTLE);
+		
+		double latest = 0;
+		for (int i=0; i<load; i++)
+		{
+			double us = diff_us(&release, &woken[i]);
+			latest = us > latest ? us : latest;
+		}
+		total += latest;
+	}
+	
+	// join threads
+	for (int i=0; i<load; i++)
+		pthread_join(tid[i], NULL);
+
+	// output results
+	fprintf(f_data, "mode=%s  sleepers=%d  release_us=%.2f\n",
+			tree ? "tree" : "flat", load, total / ROUNDS);
+
+	set_barrier_parties(group, 0, 0);
+	set_barrier_mode(group, 0, LGROUP_BARRIER_FLAT);
+	free(tid);
+	free(woken);
+	lgroup_destroy(group);
+	fclose(f_data);
+	exit(EXIT_SUCCESS);
+
+error:
+	lgroup_destroy(group);
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,177 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lgroups.h"
+#include "utils.h"
+
+#define PHASES 10000  // barrier phases per run
+
+static int load;  // threads amount
+static int counting;  // 1: counting barrier, 0: messages + awaker
+
+static struct lgroup_t *group;  // synchronization group
+static unsigned long phase = 0;  // awaker mode: current phase
+static unsigned long released = 0;  // awaker mode: released threads
+
+static FILE* f_data;
+
+
+// counting mode: the last party releases the barrier
+static void* party(void *arg)
+{
+	for(int i = 0; i < PHASES; i++)
+	{
+		if(sleep_on_barrier(group) < 0)
+		{
+			perror("Sleep on barrier");
+			exit(EXIT_FAILURE);
+		}
+	}
+	return 0;
+}
+
+// awaker mode: announce the arrival, then wait for the coordinator
+static void* worker(void *arg)
+{
+	char msg[] = "arrived";
+	
+	for(unsigned long i = 0; i < PHASES; i++)
+	{
+		if(publish_message(group, msg) < 0)
+		{
+			perror("Publish arrival");
+			exit(EXIT_FAILURE);
+		}
+		
+		// spurious releases (phase not over yet) go back to sleep
+		while(__atomic_load_n(&phase, __ATOMIC_ACQUIRE) == i)
+		{
+			if(sleep_on_barrier(group) < 0)
+			{
+				perror("Sleep on barrier");
+				exit(EXIT_FAILURE);
+			}
+		}
+		__atomic_add_fetch(&released, 1, __ATOMIC_RELEASE);
+	}
+	return 0;
+}
+
+// awaker mode: collect all arrivals, then release the phase
+static void coordinator(void)
+{
+	char buf[16];
+	
+	for(unsigned long i = 1; i <= PHASES; i++)
+	{
+		for(int arrived = 0; arrived < load; )
+		{
+			int res = deliver_message(group, buf, sizeof(buf));
+			if(res < 0)
+			{
+				perror("Deliver arrival");
+				exit(EXIT_FAILURE);
+			}
+			arrived += res > 0;
+		}
+		
+		__atomic_store_n(&phase, i, __ATOMIC_RELEASE);
+		
+		// late sleepers may miss the first awake
+		while(__atomic_load_n(&released, __ATOMIC_ACQUIRE) < i * load)
+		{
+			if(awake_barrier(group) < 0)
+			{
+				perror("Awake barrier");
+				exit(EXIT_FAILURE);
+			}
+			sched_yield();
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	struct timespec start, end;
+	pthread_t* tid;
+	int err;
+
+	if(argc<4)
+	{
+		printf("PARAMETERS: arg1=load, arg2=counting|awaker, arg3=group_id.\n");
+		exit(EXIT_FAILURE);
+	}
+	
+	// parsing parameters
+	load = atoi(argv[1]);
+	counting = !strcmp(argv[2], "counting");
+	
+	// installing benchmark group
+	group = lgroup_init();
+	
+	int res = install_group(group, argv[3]);
+	
+	if(res < 0)  // install failure
+	{
+		perror("Failed installing group");
+		goto error;
+	}
+	else if(!res)  // group already existed
+	{
+		// reset group
+		set_send_delay(group, 0);
+		revoke_delayed_messages(group);
+		char msg[2];
+		while (deliver_message(group, msg, 2));  // empty message queue
+	}
+	
+	if(set_barrier_parties(group, 0, counting ? load : 0) < 0)
+	{
+		perror("Set barrier parties");
+		goto error;
+	}
+	
+	if (!(f_data = fopen("data/barrier_tps.data", "a")))
+	{
+		perror("Open barrier_tps.data");
+		goto error;
+	}
+	
+	tid = calloc(load, sizeof(pthread_t));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	
+	// spawn barrier threads
+	for (int i=0; i<load; i++)
+	{
+		if((err = pthread_create(&(tid[i]), NULL, counting ? &party : &worker, NULL)))
+			printf("Can't create thread %d: %s.\n", i, strerror(err));
+	}
+	
+	if(!counting) coordinator();
+	
+	// join threads
+	for (int i=0; i<load; i++)
+		pthread_join(tid[i], NULL);
+	
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	
+	// output results
+	double elapsed = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+	fprintf(f_data, "mode=%s  load=%d  phases=%d  turnaround_us=%.2f\n",
+			counting ? "counting" : "awaker", load, PHASES, elapsed / PHASES);
+
+	set_barrier_parties(group, 0, 0);
+	free(tid);
+	lgroup_destroy(group);
+	fclose(f_data);
+	exit(EXIT_SUCCESS);
+
+error:
+	lgroup_destroy(group);
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "lgroups.hpp"
+
+static int load;  // round trips
+static int size;  // message size
+static bool cpp;  // binding mode
+
+static FILE* f_data;
+
+
+// publish then deliver through the raw C calls
+static void run_raw(char *id)
+{
+	struct lgroup_t *group = lgroup_init();
+	std::vector<char> msg(size, 'x'), buf(size);
+
+	if(install_group(group, id) < 0)
+	{
+		perror("Failed installing group");
+		exit(EXIT_FAILURE);
+	}
+	for (int i=0; i<load; i++)
+	{
+		if(publish_message_n(group, msg.data(), size) < 0 ||
+				deliver_message(group, buf.data(), size) < 0)
+		{
+			perror("Failed round trip");
+			exit(EXIT_FAILURE);
+		}
+	}
+	lgroup_destroy(group);
+}
+
+// same round trips through Group and ReceiveBuffer
+static void run_cpp(char *id)
+{
+	lgroups::Group group(id);
+	lgroups::ReceiveBuffer buf(size);
+	std::vector<std::byte> msg(size, std::byte{'x'});
+
+	for (int i=0; i<load; i++)
+	{
+		group.publish(msg);
+		buf.deliver(group);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if(argc<5)
+	{
+		printf("PARAMETERS: arg1=round trips, arg2=message size, arg3=raw|cpp, arg4=group.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	// parsing parameters
+	load = atoi(argv[1]);
+	size = atoi(argv[2]);
+	cpp = !strcmp(argv[3], "cpp");
+
+	if (!(f_data = fopen("data/cpp_binding.data", "a")))
+	{
+		perror("Open cpp_binding.data");
+		exit(EXIT_FAILURE);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	try
+	{
+		if(cpp)
+			run_cpp(argv[4]);
+		else
+			run_raw(argv[4]);
+	}
+	catch(const std::system_error &e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		exit(EXIT_FAILURE);
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	// output results
+	fprintf(f_data, "mode=%s  size=%d  round_trips=%d  ns_per_trip=%.1f\n",
+			cpp ? "cpp" : "raw", size, load, elapsed.count() / load);
+
+	fclose(f_data);
+	exit(EXIT_SUCCESS);
+}
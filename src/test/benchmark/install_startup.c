@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lgroups.h"
+#include "utils.h"
+
+static int load;  // groups amount
+static int batch;  // install mode
+
+static struct lgroup_t **groups;
+static char **ids;
+
+static FILE* f_data;
+
+
+static double diff_ms(struct timespec *a, struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) * 1e3 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+	struct timespec start, end;
+	int res;
+
+	if(argc<3)
+	{
+		printf("PARAMETERS: arg1=groups, arg2=single|batch.\n");
+		exit(EXIT_FAILURE);
+	}
+	
+	// parsing parameters
+	load = atoi(argv[1]);
+	batch = !strcmp(argv[2], "batch");
+	
+	if (!(f_data = fopen("data/install_startup.data", "a")))
+	{
+		perror("Open install_startup.data");
+		exit(EXIT_FAILURE);
+	}
+	
+	// fresh group ids, as at service start
+	groups = calloc(load, sizeof(struct lgroup_t*));
+	ids = calloc(load, sizeof(char*));
+	for (int i=0; i<load; i++)
+	{
+		groups[i] = lgroup_init();
+		ids[i] = rand_string(32);
+	}
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if(batch)
+		res = install_groups(groups, ids, load);
+	else
+	{
+		for (int i=0; i<load && (res = install_group(groups[i], ids[i])) >= 0; i++);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	
+	if(res < 0)
+	{
+		perror("Failed installing groups");
+		exit(EXIT_FAILURE);
+	}
+
+	// output results
+	fprintf(f_data, "mode=%s  groups=%d  startup_ms=%.2f\n",
+			batch ? "batch" : "single", load, diff_ms(&start, &end));
+
+	// leave no groups behind
+	for (int i=0; i<load; i++)
+	{
+		uninstall_group(groups[i]);
+		lgroup_destroy(groups[i]);
+		free(ids[i]);
+	}
+	free(groups);
+	free(ids);
+	fclose(f_data);
+	exit(EXIT_SUCCESS);
+}
@@ -370,7 +370,6 @@ int main(int argc, char** argv)
 				if((res = awake_barrier(lgroup)) < 0){
 					goto error;
 				}
-				else if(res==1) printf("Alarm was already on!\n");
 				else if(res==0) printf("Alarm was turned on!!\n");
 				else printf("No one's sleeping... not turning on the alarm.\n");
 
@@ -0,0 +1,117 @@
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+
+#define ASYNC_THREADS 2
+#define ASYNC_MSGS 3
+#define ASYNC_SLEEPS 8  // more than ASYNC_THREADS
+
+static int published, cancelled;
+
+static void on_publish(struct lgroup_completion_t *completion)
+{
+	if (completion->res == completion->size)
+		__atomic_add_fetch(&published, 1, __ATOMIC_RELAXED);
+}
+
+static void on_cancel(struct lgroup_completion_t *completion)
+{
+	if (completion->res == -2 && completion->err == ECANCELED)
+		__atomic_add_fetch(&cancelled, 1, __ATOMIC_RELAXED);
+}
+
+void test_async(void)
+{
+	struct lgroup_completion_t completions[ASYNC_MSGS];
+	char msg[] = "async", bufs[ASYNC_MSGS][32];
+	int res = -1;
+	
+	// installing test group
+	struct lgroup_t *test_group = lgroup_init();
+	res = install_group(test_group, "async");
+	TEST_ASSERT_(res>=0, 1, "test group - install ok");
+	
+	// group already existed
+	if(!res)
+	{
+		// reset group
+		set_send_delay(test_group, 0);
+		revoke_delayed_messages(test_group);
+		char msg[2];
+		while (deliver_message(test_group, msg, 2));  // empty message queue
+	}
+	
+	struct lgroup_async_t *async = lgroup_async_init(ASYNC_THREADS);
+	TEST_ASSERT_(async != NULL, 1, "async pool");
+	
+	// completions through callbacks
+	for (int i=0; i < ASYNC_MSGS; i++)
+		async_publish(async, test_group, msg, sizeof(msg), on_publish, NULL);
+	res = async_reap(async, completions, ASYNC_MSGS, 1);  // no queued completion
+	TEST_CHECK_(res==0 && published==ASYNC_MSGS, 0, "publish, exp: %d, got: %d", ASYNC_MSGS, published);
+	
+	// completions through the queue
+	for (int i=0; i < ASYNC_MSGS; i++)
+		async_deliver(async, test_group, bufs[i], sizeof(bufs[i]), NULL, bufs[i]);
+	for (int n=0; n < ASYNC_MSGS; n += res)
+	{
+		res = async_reap(async, completions + n, ASYNC_MSGS - n, 1);
+		TEST_ASSERT_(res > 0, 1, "reap deliveries");
+	}
+	for (int i=0; i < ASYNC_MSGS; i++)
+		TEST_CHECK_(completions[i].res==sizeof(msg) && !strcmp(completions[i].user_data, msg), 0, 
+				"deliver %d, exp: %zu, got: %d", i, sizeof(msg), completions[i].res);
+	
+	// a sleeping barrier doesn't block the caller
+	res = async_sleep_on_barrier(async, test_group, 1, NULL, NULL);
+	TEST_CHECK_(res==0, 0, "barrier submission");
+	msleep(TEST_EPSILON);
+	res = async_reap(async, completions, 1, 0);
+	TEST_CHECK_(res==0, 0, "barrier still asleep, got: %d", res);
+	awake_barrier_id(test_group, 1);
+	res = async_reap(async, completions, 1, 1);
+	TEST_CHECK_(res==1 && completions[0].res>=0 && completions[0].op==LGROUP_ASYNC_BARRIER, 0, 
+			"barrier released, got: %d", res);
+	
+	// sleeps outnumbering the threads don't stall other operations
+	for (int i=0; i < ASYNC_SLEEPS; i++)
+		async_sleep_on_barrier(async, test_group, 2, NULL, NULL);
+	async_publish(async, test_group, msg, sizeof(msg), NULL, NULL);
+	res = async_reap(async, completions, 1, 1);
+	TEST_CHECK_(res==1 && completions[0].op==LGROUP_ASYNC_PUBLISH, 0, 
+			"publish behind sleeps, got: %d (op %d)", res, completions[0].op);
+	deliver_message(test_group, bufs[0], sizeof(bufs[0]));
+	awake_barrier_id(test_group, 2);
+	for (int n=0; n < ASYNC_SLEEPS; n += res)
+	{
+		res = async_reap(async, completions, ASYNC_MSGS, 1);
+		TEST_ASSERT_(res > 0, 1, "reap sleeps");
+		for (int i=0; i < res; i++)
+			TEST_CHECK_(completions[i].op==LGROUP_ASYNC_BARRIER && completions[i].res>=0, 0, 
+					"sleep released, got: %d", completions[i].res);
+	}
+	
+	// a delivery on an empty queue waits for a message
+	async_deliver(async, test_group, bufs[0], sizeof(bufs[0]), NULL, NULL);
+	msleep(TEST_EPSILON);
+	res = async_reap(async, completions, 1, 0);
+	TEST_CHECK_(res==0, 0, "delivery still waiting, got: %d", res);
+	publish_message(test_group, msg);
+	res = async_reap(async, completions, 1, 1);
+	TEST_CHECK_(res==1 && completions[0].op==LGROUP_ASYNC_DELIVER && completions[0].res==sizeof(msg), 0, 
+			"delivery woken, got: %d (res %d)", res, completions[0].res);
+	
+	// pending sleeps leave the barrier and deliveries give up on destroy
+	async_sleep_on_barrier(async, test_group, 2, on_cancel, NULL);
+	async_deliver(async, test_group, bufs[0], sizeof(bufs[0]), on_cancel, NULL);
+	msleep(TEST_EPSILON/2);
+	lgroup_async_destroy(async);
+	TEST_CHECK_(cancelled==2, 0, "operations cancelled, exp: %d, got: %d", 2, cancelled);
+	res = awake_barrier_id(test_group, 2);
+	TEST_CHECK_(res==2, 0, "no one left on the barrier, exp: %d, got: %d", 2, res);
+	
+	lgroup_destroy(test_group);
+}
@@ -0,0 +1,76 @@
+#include <pthread.h>
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+#define SLEEPERS 4
+#define PAYLOAD_BARRIER 2
+
+
+static struct lgroup_t *test_group;
+
+struct sleeper_t {
+	pthread_t tid;
+	char payload[LGROUP_BARRIER_PAYLOAD_MAX];
+	unsigned int size;
+	int res;
+};
+
+
+static void* sleeper(void *arg)
+{
+	struct sleeper_t *s = arg;
+	
+	s->size = sizeof(s->payload);
+	s->res = sleep_on_barrier_payload(test_group, PAYLOAD_BARRIER, s->payload, &s->size);
+	return NULL;
+}
+
+void test_barrier_payload(void)
+{
+	struct sleeper_t sleepers[SLEEPERS];
+	char *epoch = "epoch 42";
+	unsigned int size = strlen(epoch)+1;
+	int res = -1;
+	
+	// installing test group
+	test_group = lgroup_init();
+	res = install_group(test_group, "barrier_payload");
+	TEST_ASSERT_(res>=0, 1, "test group - install ok");
+	
+	for (int i = 0; i < SLEEPERS; i++)
+		pthread_create(&sleepers[i].tid, NULL, &sleeper, &sleepers[i]);
+	msleep(TEST_EPSILON/2);  // let them sleep
+	
+	// every sleeper gets the payload back
+	res = awake_barrier_payload(test_group, PAYLOAD_BARRIER, epoch, size);
+	TEST_CHECK_(res==0, 0, "awake with payload, exp: %d, got: %d", 0, res);
+	for (int i = 0; i < SLEEPERS; i++)
+	{
+		pthread_join(sleepers[i].tid, NULL);
+		TEST_CHECK_(sleepers[i].res==0, 0, "sleeper %d, exp: %d, got: %d", i, 0, sleepers[i].res);
+		TEST_CHECK_(sleepers[i].size==size && !strcmp(sleepers[i].payload, epoch), 0,
+				"sleeper %d payload, exp: %s, got: %.*s", i, epoch, sleepers[i].size, sleepers[i].payload);
+	}
+	
+	// a plain release carries no payload
+	pthread_create(&sleepers[0].tid, NULL, &sleeper, &sleepers[0]);
+	msleep(TEST_EPSILON/2);
+	awake_barrier_id(test_group, PAYLOAD_BARRIER);
+	pthread_join(sleepers[0].tid, NULL);
+	TEST_CHECK_(sleepers[0].res==0 && sleepers[0].size==0, 0, 
+			"plain release payload size, exp: %d, got: %u", 0, sleepers[0].size);
+	
+	// no sleepers, no release
+	res = awake_barrier_payload(test_group, PAYLOAD_BARRIER, epoch, size);
+	TEST_CHECK_(res==2, 0, "awake with no sleepers, exp: %d, got: %d", 2, res);
+	
+	// oversized payload
+	res = awake_barrier_payload(test_group, PAYLOAD_BARRIER, epoch, LGROUP_BARRIER_PAYLOAD_MAX+1);
+	TEST_CHECK_(res==-2 && errno==EINVAL, 0, "oversized payload, got: %d", res);
+	
+	lgroup_destroy(test_group);
+}
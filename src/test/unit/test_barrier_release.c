@@ -0,0 +1,110 @@
+#include <pthread.h>
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+#define SWITCH_BARRIER 3
+#define AWAKER_BARRIER 4
+#define PARTIES 3
+
+
+static struct lgroup_t *test_group;
+
+struct party_t {
+	pthread_t tid;
+	unsigned int barrier;
+	int phases;
+	int serials;
+	int done;  // phases completed
+	int res;
+};
+
+
+static void* party(void *arg)
+{
+	struct party_t *p = arg;
+	
+	for(int i = 0; i < p->phases; i++)
+	{
+		if((p->res = sleep_on_barrier_id(test_group, p->barrier)) < 0)
+			break;
+		if(p->res == LGROUP_BARRIER_SERIAL_THREAD)
+			p->serials++;
+		__atomic_add_fetch(&p->done, 1, __ATOMIC_SEQ_CST);
+	}
+	return NULL;
+}
+
+static void parties_spawn(struct party_t *parties, int count, unsigned int barrier, int phases)
+{
+	for (int i = 0; i < count; i++)
+	{
+		parties[i] = (struct party_t) { .barrier = barrier, .phases = phases };
+		pthread_create(&parties[i].tid, NULL, &party, &parties[i]);
+	}
+}
+
+// joins parties, returns their serial threads
+static int parties_join(struct party_t *parties, int count)
+{
+	int serials = 0;
+	
+	for (int i = 0; i < count; i++)
+	{
+		pthread_join(parties[i].tid, NULL);
+		TEST_CHECK_(parties[i].res>=0, 0, "party %d, got: %d", i, parties[i].res);
+		serials += parties[i].serials;
+	}
+	return serials;
+}
+
+void test_barrier_release(void)
+{
+	struct party_t parties[PARTIES];
+	int phases = 10, res = -1;
+	
+	// installing test group
+	test_group = lgroup_init();
+	res = install_group(test_group, "barrier_release");
+	TEST_ASSERT_(res>=0, 1, "test group - install ok");
+	
+	// awaker-driven sleepers released by turning the barrier into a counting one
+	parties_spawn(parties, PARTIES-1, SWITCH_BARRIER, 1);
+	msleep(TEST_EPSILON/2);  // let them sleep
+	res = set_barrier_parties(test_group, SWITCH_BARRIER, PARTIES-1);
+	TEST_CHECK_(res==LGROUP_BARRIER_SERIAL_THREAD, 0, "switch parties, exp: %d, got: %d", 
+			LGROUP_BARRIER_SERIAL_THREAD, res);
+	parties_join(parties, PARTIES-1);
+	
+	// released sleepers left no arrivals behind: full phases follow
+	parties_spawn(parties, PARTIES-1, SWITCH_BARRIER, phases);
+	res = parties_join(parties, PARTIES-1);
+	TEST_CHECK_(res==phases, 0, "serial threads after switch, exp: %d, got: %d", phases, res);
+	res = awake_barrier_id(test_group, SWITCH_BARRIER);
+	TEST_CHECK_(res==2, 0, "no one left after switch, exp: %d, got: %d", 2, res);
+	set_barrier_parties(test_group, SWITCH_BARRIER, 0);
+	
+	// an awaker releasing a counting barrier restarts its arrivals
+	set_barrier_parties(test_group, AWAKER_BARRIER, PARTIES);
+	parties_spawn(parties, 1, AWAKER_BARRIER, 1);
+	msleep(TEST_EPSILON/2);
+	res = awake_barrier_id(test_group, AWAKER_BARRIER);
+	TEST_CHECK_(res==0, 0, "awake counting barrier, exp: %d, got: %d", 0, res);
+	parties_join(parties, 1);
+	
+	// the next phase still needs all of its parties
+	parties_spawn(parties, PARTIES-1, AWAKER_BARRIER, 1);
+	msleep(TEST_EPSILON/2);
+	res = __atomic_load_n(&parties[0].done, __ATOMIC_SEQ_CST) + 
+			__atomic_load_n(&parties[1].done, __ATOMIC_SEQ_CST);
+	TEST_CHECK_(res==0, 0, "early release after awake, exp: %d, got: %d", 0, res);
+	parties_spawn(&parties[PARTIES-1], 1, AWAKER_BARRIER, 1);
+	res = parties_join(parties, PARTIES);
+	TEST_CHECK_(res==1, 0, "serial threads after awake, exp: %d, got: %d", 1, res);
+	set_barrier_parties(test_group, AWAKER_BARRIER, 0);
+	
+	lgroup_destroy(test_group);
+}
@@ -0,0 +1,54 @@
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+
+static long elapsed_ms(struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+void test_barrier_timeout(void)
+{
+	struct timespec start, timeout = { 0, TEST_EPSILON * 1000000L };
+	int res = -1;
+	long ms;
+	
+	// installing test group
+	struct lgroup_t *test_group = lgroup_init();
+	res = install_group(test_group, "barrier_timeout");
+	TEST_ASSERT_(res>=0, 1, "test group - install ok");
+	
+	// relative timeout, no awaker
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	res = sleep_on_barrier_timed(test_group, 0, &timeout, 0);
+	ms = elapsed_ms(&start);
+	TEST_CHECK_(res==-3, 0, "relative timeout, exp: %d, got: %d", -3, res);
+	TEST_CHECK_(ms >= TEST_EPSILON && ms < 2*TEST_EPSILON, 0, 
+			"relative timeout, slept %ld ms, exp: %d ms", ms, TEST_EPSILON);
+	
+	// the expired sleeper left the barrier
+	res = awake_barrier(test_group);
+	TEST_CHECK_(res==2, 0, "awake after timeout, exp: %d, got: %d", 2, res);
+	
+	// absolute timeout, no awaker
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	timeout = start;
+	timeout.tv_nsec += TEST_EPSILON * 1000000L;
+	timeout.tv_sec += timeout.tv_nsec / 1000000000L;
+	timeout.tv_nsec %= 1000000000L;
+	res = sleep_on_barrier_timed(test_group, 0, &timeout, LGROUP_ABSTIME);
+	ms = elapsed_ms(&start);
+	TEST_CHECK_(res==-3, 0, "absolute timeout, exp: %d, got: %d", -3, res);
+	TEST_CHECK_(ms >= TEST_EPSILON && ms < 2*TEST_EPSILON, 0, 
+			"absolute timeout, slept %ld ms, exp: %d ms", ms, TEST_EPSILON);
+	
+	res = awake_barrier(test_group);
+	TEST_CHECK_(res==2, 0, "awake after deadline, exp: %d, got: %d", 2, res);
+	
+	lgroup_destroy(test_group);
+}
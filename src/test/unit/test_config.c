@@ -0,0 +1,57 @@
+#include <sys/ioctl.h>
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "groups.h"
+#include "utils.h"
+#include "lgroups.h"
+
+
+void test_config(void)
+{
+	TEST_ASSERT_(geteuid()==0, 0, "root privileges");
+	
+	struct lgroup_config_t old_config, config, new_config = 
+			{ .max_message_size = 300, .max_storage_size = 3000, .delay = 50 };
+	unsigned long size;
+	
+	// installing test group
+	struct lgroup_t *test_group = lgroup_init();
+	int res = install_group(test_group, "config");
+	TEST_ASSERT_(res>=0, 0, "config group install");
+	
+	res = get_group_config(test_group, &old_config);
+	TEST_ASSERT_(!res, 0, "read config: %s", strerror(errno));
+	
+	// all parameters at once
+	res = set_group_config(test_group, &new_config);
+	TEST_ASSERT_(!res, 0, "write config: %s", strerror(errno));
+	res = get_group_config(test_group, &config);
+	TEST_CHECK_(!res && config.max_message_size == 300 && config.max_storage_size == 3000 
+			&& config.delay == 50, 0, "config: read %lu %lu %u, expected 300 3000 50.", 
+			config.max_message_size, config.max_storage_size, config.delay);
+	
+	// single parameters leave the others alone
+	res = set_max_message_size(test_group, 400);
+	TEST_CHECK_(!res, 0, "write max_message_size: %s", strerror(errno));
+	res = get_max_storage_size(test_group, &size);
+	TEST_CHECK_(!res && size == 3000, 0, "max_storage_size: read %lu, expected 3000.", size);
+	res = get_max_message_size(test_group, &size);
+	TEST_CHECK_(!res && size == 400, 0, "max_message_size: read %lu, expected 400.", size);
+	
+	// unknown mask bits and reserved fields are refused, nothing is updated
+	int fd_lkm_group = open("/dev/group0", O_RDWR);
+	TEST_ASSERT_(fd_lkm_group!=-1, 1, "group0 installed");
+	struct group_config_t k_config = { .mask = GROUP_CONFIG_ALL + 1 };
+	res = ioctl(fd_lkm_group, SET_CONFIG, &k_config);
+	TEST_CHECK_(res==-1 && errno==EINVAL, 0, "unknown mask bit, exp: EINVAL, got: %s", strerror(errno));
+	k_config = (struct group_config_t) { .mask = GROUP_CONFIG_DELAY, .reserved[3] = 1 };
+	res = ioctl(fd_lkm_group, SET_CONFIG, &k_config);
+	TEST_CHECK_(res==-1 && errno==EINVAL, 0, "reserved field, exp: EINVAL, got: %s", strerror(errno));
+	close(fd_lkm_group);
+	
+	// restore old parameters
+	set_group_config(test_group, &old_config);
+	lgroup_destroy(test_group);
+}
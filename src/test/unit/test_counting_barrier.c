@@ -0,0 +1,72 @@
+#include <pthread.h>
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "lgroups.h"
+
+#define PARTIES 4
+
+
+static int phases = 10;  // test iterations
+
+static struct lgroup_t *test_group;
+static int serials = 0;
+static pthread_mutex_t serials_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static void* party(void *arg)
+{
+	int res;
+	
+	for(int i = 0; i < phases; i++)
+	{
+		res = sleep_on_barrier(test_group);
+		TEST_ASSERT_(res>=0, 0, "sleep ioctl: %s", strerror(errno));
+		
+		if(res == LGROUP_BARRIER_SERIAL_THREAD)
+		{
+			pthread_mutex_lock(&serials_lock);
+			serials++;
+			pthread_mutex_unlock(&serials_lock);
+		}
+	}
+	
+	return NULL;
+}
+
+void test_counting_barrier(void)
+{
+	int err, res = -1;
+	pthread_t tid[PARTIES];
+	
+	// installing test group
+	test_group = lgroup_init();
+	res = install_group(test_group, "counting_barrier");
+	TEST_ASSERT_(res>=0, 1, "test group - install ok");
+	
+	res = set_barrier_parties(test_group, 0, PARTIES);
+	TEST_ASSERT_(res==0, 0, "set parties, exp: %d, got: %d", 0, res);
+	
+	// spawn parties
+	for (int i = 0; i < PARTIES; i++)
+	{
+		err = pthread_create(&(tid[i]), NULL, &party, NULL);
+		TEST_ASSERT_(!err, 0, "spawn party%d: %s", i+1, strerror(errno));
+	}
+	
+	// join threads
+	for (int i = 0; i < PARTIES; i++)
+		pthread_join(tid[i], NULL);
+	
+	// exactly one serial thread per phase
+	TEST_CHECK_(serials == phases, 0, "serial threads, exp: %d, got: %d", phases, serials);
+	
+	// no one left on the barrier
+	res = awake_barrier(test_group);
+	TEST_CHECK_(res==2, 0, "awake ioctl, exp: %d, got: %d", 2, res);
+	
+	// restore awaker-driven barrier
+	set_barrier_parties(test_group, 0, 0);
+	lgroup_destroy(test_group);
+}
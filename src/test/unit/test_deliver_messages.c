@@ -0,0 +1,79 @@
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+
+#define BUFFERS 4
+#define MSGS 5
+
+void test_deliver_messages(void)
+{
+	char bufs[BUFFERS][64];
+	void *addrs[BUFFERS] = { bufs[0], bufs[1], bufs[2], bufs[3] };
+	unsigned long sizes[BUFFERS] = { 8, 64, 16, 16 };
+	int lens[MSGS] = { 5, 10, 40, 12, 6 }, exp_bufs[MSGS] = { 0, 2, 1, 3, 0 };
+	struct lgroup_delivery_t deliveries[2 * MSGS];
+	char *msgs[MSGS];
+	int res = -1;
+	
+	// installing test group
+	struct lgroup_t *test_group = lgroup_init();
+	res = install_group(test_group, "deliver messages");
+	TEST_ASSERT_(res>=0, 1, "test group - install ok");
+	
+	// group already existed
+	if(!res)
+	{
+		// reset group
+		set_send_delay(test_group, 0);
+		revoke_delayed_messages(test_group);
+		char msg[2];
+		while (deliver_message(test_group, msg, 2));  // empty message queue
+	}
+	
+	res = register_buffers(test_group, addrs, sizes, BUFFERS);
+	TEST_ASSERT_(res==0, 1, "register buffers: %s", strerror(errno));
+	
+	for (int i=0; i < MSGS; i++)
+	{
+		msgs[i] = rand_string(lens[i]);
+		publish_message(test_group, msgs[i]);
+	}
+	
+	// each buffer is used once per call
+	res = deliver_messages(test_group, deliveries, 2 * MSGS, 0);
+	TEST_CHECK_(res==MSGS-1, 0, "first batch, exp: %d, got: %d", MSGS-1, res);
+	res = deliver_messages(test_group, deliveries + MSGS-1, 2 * MSGS, 0);
+	TEST_CHECK_(res==1, 0, "second batch, exp: %d, got: %d", 1, res);
+	
+	// best fits
+	for (int i=0; i < MSGS; i++)
+	{
+		TEST_CHECK_(deliveries[i].buffer==exp_bufs[i] && deliveries[i].size==lens[i], 0, 
+				"message %d, exp: buffer %d (%d), got: buffer %u (%u)", 
+				i, exp_bufs[i], lens[i], deliveries[i].buffer, deliveries[i].size);
+		if (i == MSGS-1)
+			TEST_CHECK_(!strcmp(bufs[deliveries[i].buffer], msgs[i]), 0, "message %d content", i);
+	}
+	
+	// blocking call
+	set_send_delay(test_group, TEST_DELAY);
+	publish_message(test_group, msgs[0]);
+	res = deliver_messages(test_group, deliveries, 1, 0);
+	TEST_CHECK_(res==0, 0, "early batch, exp: %d, got: %d", 0, res);
+	res = deliver_messages(test_group, deliveries, 1, 1);
+	TEST_CHECK_(res==1 && !strcmp(bufs[deliveries[0].buffer], msgs[0]), 0, 
+			"blocking batch, exp: %d, got: %d", 1, res);
+	set_send_delay(test_group, 0);
+	
+	// unregistered
+	register_buffers(test_group, NULL, NULL, 0);
+	res = deliver_messages(test_group, deliveries, 1, 0);
+	TEST_CHECK_(res==-2 && errno==ENOBUFS, 0, "unregistered, exp: %d, got: %d", -2, res);
+	
+	for (int i=0; i < MSGS; i++)
+		free(msgs[i]);
+	lgroup_destroy(test_group);
+}
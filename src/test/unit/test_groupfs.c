@@ -0,0 +1,73 @@
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+
+
+void test_groupfs(void)
+{
+	char mnt_first[] = "/tmp/groupfs.XXXXXX", mnt_second[] = "/tmp/groupfs.XXXXXX";
+	char path[64], buf[32];
+	int fd_first, fd_second, res = -1;
+	
+	TEST_ASSERT_(mkdtemp(mnt_first) && mkdtemp(mnt_second), 1, "mount points: %s", strerror(errno));
+	res = mount("groupfs", mnt_first, "groupfs", 0, NULL);
+	TEST_ASSERT_(res == 0, 1, "mount groupfs: %s", strerror(errno));
+	res = mount("groupfs", mnt_second, "groupfs", 0, "max_groups=1");
+	TEST_ASSERT_(res == 0, 1, "second mount: %s", strerror(errno));
+	
+	// creation, no udev wait
+	sprintf(path, "%s/%s", mnt_first, "test_groupfs");
+	fd_first = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+	TEST_ASSERT_(fd_first != -1, 1, "create %s: %s", path, strerror(errno));
+	
+	// lookup, the same group
+	fd_second = open(path, O_RDWR);
+	TEST_ASSERT_(fd_second != -1, 1, "open %s: %s", path, strerror(errno));
+	res = write(fd_first, "hello", 6);
+	TEST_CHECK_(res == 6, 0, "write, exp: %d, got: %d", 6, res);
+	res = read(fd_second, buf, sizeof(buf));
+	TEST_CHECK_(res == 6 && !strcmp(buf, "hello"), 0, "read, exp: %d, got: %d", 6, res);
+	
+	// mounts don't share groups
+	sprintf(path, "%s/%s", mnt_second, "test_groupfs");
+	TEST_CHECK_(access(path, F_OK) == -1, 0, "%s visible from another mount", path);
+	
+	// max_groups bounds the groups of a mount
+	res = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+	TEST_CHECK_(res != -1, 0, "create %s: %s", path, strerror(errno));
+	close(res);
+	sprintf(path, "%s/%s", mnt_second, "over_quota");
+	res = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+	TEST_CHECK_(res == -1 && errno == EDQUOT, 0, "create past max_groups, got: %d", res);
+	if (res != -1)
+		close(res);
+	
+	// hierarchical names
+	sprintf(path, "%s/%s", mnt_first, "dir");
+	TEST_CHECK_(mkdir(path, 0700) == 0, 0, "mkdir %s: %s", path, strerror(errno));
+	sprintf(path, "%s/%s", mnt_first, "dir/nested");
+	res = open(path, O_RDWR | O_CREAT, 0600);
+	TEST_CHECK_(res != -1, 0, "create %s: %s", path, strerror(errno));
+	close(res);
+	
+	// the group lives on until its last close
+	sprintf(path, "%s/%s", mnt_first, "test_groupfs");
+	TEST_CHECK_(unlink(path) == 0, 0, "unlink %s: %s", path, strerror(errno));
+	res = write(fd_first, "world", 6);
+	TEST_CHECK_(res == 6, 0, "write after unlink, exp: %d, got: %d", 6, res);
+	res = read(fd_second, buf, sizeof(buf));
+	TEST_CHECK_(res == 6 && !strcmp(buf, "world"), 0, "read after unlink, exp: %d, got: %d", 6, res);
+	
+	close(fd_first);
+	close(fd_second);
+	
+	TEST_CHECK_(umount(mnt_first) == 0, 0, "umount %s: %s", mnt_first, strerror(errno));
+	TEST_CHECK_(umount(mnt_second) == 0, 0, "umount %s: %s", mnt_second, strerror(errno));
+	rmdir(mnt_first);
+	rmdir(mnt_second);
+}
@@ -14,7 +14,8 @@ void test_install_group(void) {
 	int fd_lkm_group = open("/dev/group0", O_RDWR);
 	TEST_ASSERT_(fd_lkm_group!=-1, 1, "group0 installed");
 	
-	sprintf(exp_devname, "group%d", next_group()); // next available group
+	// next available group, assuming no one else installs meanwhile
+	sprintf(exp_devname, "group%d", next_group());
 	
 	// group first install
 	char *group_id;
@@ -0,0 +1,63 @@
+#include <sys/ioctl.h>
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "groups.h"
+#include "utils.h"
+
+
+void test_install_group_fd(void)
+{
+	struct group_fd_t install = { .installed = -1 };
+	char exp_devname[32], devpath[64], buf[32], *group_id;
+	int fd_first, fd_second, fd_path, res = -1;
+	
+	int fd_lkm_group = open("/dev/group0", O_RDWR);
+	TEST_ASSERT_(fd_lkm_group!=-1, 1, "group0 installed");
+	
+	// next available group, assuming no one else installs meanwhile
+	sprintf(exp_devname, "group%d", next_group());
+	group_id = rand_string(32);
+	strncpy(install.group.id, group_id, 32);
+	free(group_id);
+	
+	// first install, the group comes open: no udev wait
+	fd_first = ioctl(fd_lkm_group, INSTALL_GROUP_FD, &install);
+	TEST_ASSERT_(fd_first >= 0, 1, "first install: %s", strerror(errno));
+	TEST_CHECK_(install.installed == 1 && !strcmp(install.group.devname, exp_devname), 0,
+			"first install, got: %s (%d), exp: %s (1).",
+			install.group.devname, install.installed, exp_devname);
+	
+	// no /dev node until it is exported
+	sprintf(devpath, "/dev/%s", exp_devname);
+	TEST_CHECK_(access(devpath, F_OK) == -1, 0, "%s exists before export", devpath);
+	res = ioctl(fd_first, EXPORT_GROUP);
+	TEST_CHECK_(res == 0, 0, "export: %s", strerror(errno));
+	res = ioctl(fd_first, EXPORT_GROUP);
+	TEST_CHECK_(res == 0, 0, "second export: %s", strerror(errno));
+	
+	// give udevd time to do its job
+	msleep(UDEV_WAIT);
+	sprintf(devpath, "/dev/synch/%s", exp_devname);
+	fd_path = open(devpath, O_RDWR);
+	TEST_CHECK_(fd_path != -1, 0, "%s: %s", devpath, strerror(errno));
+	close(fd_path);
+	
+	// second install, same group
+	install.installed = -1;
+	fd_second = ioctl(fd_lkm_group, INSTALL_GROUP_FD, &install);
+	TEST_ASSERT_(fd_second >= 0, 1, "second install: %s", strerror(errno));
+	TEST_CHECK_(install.installed == 0 && !strcmp(install.group.devname, exp_devname), 0,
+			"second install, got: %s (%d)", install.group.devname, install.installed);
+	
+	// both descriptors share the group queue
+	res = write(fd_first, "hello", 6);
+	TEST_CHECK_(res == 6, 0, "write, exp: %d, got: %d", 6, res);
+	res = read(fd_second, buf, sizeof(buf));
+	TEST_CHECK_(res == 6 && !strcmp(buf, "hello"), 0, "read, exp: %d, got: %d", 6, res);
+	
+	close(fd_first);
+	close(fd_second);
+	close(fd_lkm_group);
+}
@@ -0,0 +1,46 @@
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+#define BATCH 8
+
+
+void test_install_groups(void)
+{
+	struct lgroup_t *lgroups[BATCH];
+	char *ids[BATCH], buf[32];
+	int res = -1;
+	
+	for (int i = 0; i < BATCH; i++)
+	{
+		lgroups[i] = lgroup_init();
+		ids[i] = rand_string(32);
+	}
+	
+	// one already installed, one duplicate within the batch
+	res = install_group(lgroups[0], ids[0]);
+	TEST_ASSERT_(res==1, 1, "single install, got: %d", res);
+	strcpy(ids[BATCH-1], ids[BATCH-2]);
+	
+	res = install_groups(lgroups, ids, BATCH);
+	TEST_CHECK_(res==BATCH-2, 0, "batch install, exp: %d, got: %d", BATCH-2, res);
+	
+	// every lgroup is usable right away, duplicates share the group
+	for (int i = 0; i < BATCH; i++)
+	{
+		res = publish_message(lgroups[i], "batch");
+		TEST_CHECK_(res>0, 0, "lgroup %d publish, got: %d", i, res);
+	}
+	res = deliver_message(lgroups[BATCH-1], buf, sizeof(buf));
+	res += deliver_message(lgroups[BATCH-2], buf, sizeof(buf));
+	res += deliver_message(lgroups[BATCH-2], buf, sizeof(buf));
+	TEST_CHECK_(res==3*6, 0, "duplicates deliver, exp: %d, got: %d", 3*6, res);
+	
+	for (int i = 0; i < BATCH; i++)
+	{
+		lgroup_destroy(lgroups[i]);
+		free(ids[i]);
+	}
+}
@@ -7,35 +7,80 @@
 #include "groups.h"
 #include "utils.h"
 
+// spans several chrdev regions, registered on demand by the module
+#define INSTALLS 5000
+
+// minors allowed past the ones in use, once max_minors is lowered
+#define QUOTA_SLACK 10
+
+#define MAX_MINORS "/sys/module/groups/parameters/max_minors"
+
+
+// sets the module's max_minors, returns the previous value (0: unavailable)
+static unsigned int set_max_minors(unsigned int max)
+{
+	unsigned int old = 0;
+	FILE *f;
+	
+	if(!(f = fopen(MAX_MINORS, "r")))
+		return 0;
+	if(fscanf(f, "%u", &old) != 1)
+		old = 0;
+	fclose(f);
+	
+	if(!old || !(f = fopen(MAX_MINORS, "w")))
+		return 0;
+	fprintf(f, "%u\n", max);
+	fclose(f);
+	
+	return old;
+}
+
+// installs a new group with a random id
+static int install_random(int fd_lkm_group, struct group_t *group)
+{
+	char *buf = rand_string(32);
+	
+	strcpy(group->id, buf);
+	free(buf);
+	return ioctl(fd_lkm_group, INSTALL_GROUP, group);
+}
 
 void test_max_install(void)
 {
 	int res = -1, fd_lkm_group = open("/dev/group0", O_RDWR);
 	TEST_ASSERT_(fd_lkm_group!=-1, 1, "group0 installed");
 	
+	// minors are allocated cyclically: no other test may install meanwhile
 	unsigned long groups = (unsigned long) next_group();
+	unsigned int limit, old, i;
 	struct group_t group;
-	char exp_devname[32], *buf;
+	char exp_devname[32];
 	
-	while(groups < 2000)  // 2000 = kernel-level information
+	while(groups < INSTALLS)
 	{
 		// install new group
-		buf = rand_string(32);
-		strcpy(group.id, buf);
-		free(buf);
-		res = ioctl(fd_lkm_group, INSTALL_GROUP, &group);
+		res = install_random(fd_lkm_group, &group);
 		sprintf(exp_devname, "group%lu", groups++);
-		TEST_ASSERT_(!strcmp(group.devname, exp_devname), 0,
+		TEST_ASSERT_(res == 1 && !strcmp(group.devname, exp_devname), 0,
 				"expected: %s, got: %s, ioctl res = %d.",
 				exp_devname, group.devname, res);
 	}
 	
-	buf = rand_string(32);
-	strcpy(group.id, buf);
-	free(buf);
-	res = ioctl(fd_lkm_group, INSTALL_GROUP, &group);
-	TEST_CHECK_(res == -1 && errno == EDQUOT, 0, 
-			"last install: new devname: %s, ioctl res = %d.", group.devname, res);
+	// quota: lowered max_minors, the free minors below it run out
+	limit = groups + QUOTA_SLACK;
+	old = set_max_minors(limit);
+	TEST_CHECK_(old, 0, "max_minors parameter available");
+	if(old)
+	{
+		for(i = 0; i <= limit && (res = install_random(fd_lkm_group, &group)) != -1; i++);
+		TEST_CHECK_(res == -1 && errno == EDQUOT, 0, 
+				"install past max_minors: new devname: %s, ioctl res = %d.", group.devname, res);
+		set_max_minors(old);
+		
+		res = install_random(fd_lkm_group, &group);
+		TEST_CHECK_(res == 1, 0, "install with max_minors restored, ioctl res = %d.", res);
+	}
 	
 	close(fd_lkm_group);
 }
@@ -0,0 +1,83 @@
+#include <pthread.h>
+
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+#define AWAKER_BARRIER 1
+#define COUNTING_BARRIER (LGROUP_BARRIERS-1)
+
+
+static struct lgroup_t *test_group;
+
+
+static void* timed_sleeper(void *arg)
+{
+	struct timespec timeout = { 0, 2 * TEST_EPSILON * 1000000L };
+	
+	// no one awakes barrier 0
+	long res = sleep_on_barrier_timed(test_group, 0, &timeout, 0);
+	return (void*) res;
+}
+
+static void* awaker_sleeper(void *arg)
+{
+	long res = sleep_on_barrier_id(test_group, AWAKER_BARRIER);
+	return (void*) res;
+}
+
+static void* party(void *arg)
+{
+	long res = sleep_on_barrier_id(test_group, COUNTING_BARRIER);
+	return (void*) res;
+}
+
+void test_multi_barrier(void)
+{
+	pthread_t timed, sleeper, parties[2];
+	void *ret;
+	long serials = 0;
+	int res = -1;
+	
+	// installing test group
+	test_group = lgroup_init();
+	res = install_group(test_group, "multi_barrier");
+	TEST_ASSERT_(res>=0, 1, "test group - install ok");
+	
+	res = set_barrier_parties(test_group, COUNTING_BARRIER, 2);
+	TEST_ASSERT_(res==0, 0, "set parties, exp: %d, got: %d", 0, res);
+	
+	pthread_create(&timed, NULL, &timed_sleeper, NULL);
+	pthread_create(&sleeper, NULL, &awaker_sleeper, NULL);
+	msleep(TEST_EPSILON/2);  // let them sleep
+	
+	// releasing barrier 1 doesn't touch barrier 0
+	res = awake_barrier_id(test_group, AWAKER_BARRIER);
+	TEST_CHECK_(res==0, 0, "awake barrier %d, exp: %d, got: %d", AWAKER_BARRIER, 0, res);
+	pthread_join(sleeper, &ret);
+	TEST_CHECK_((long) ret==0, 0, "barrier %d sleeper, exp: %d, got: %ld", AWAKER_BARRIER, 0, (long) ret);
+	
+	// counting barrier releases itself
+	for (int i = 0; i < 2; i++)
+		pthread_create(&parties[i], NULL, &party, NULL);
+	for (int i = 0; i < 2; i++)
+	{
+		pthread_join(parties[i], &ret);
+		TEST_CHECK_((long) ret>=0, 0, "barrier %d party: %ld", COUNTING_BARRIER, (long) ret);
+		serials += (long) ret == LGROUP_BARRIER_SERIAL_THREAD;
+	}
+	TEST_CHECK_(serials==1, 0, "serial threads, exp: %d, got: %ld", 1, serials);
+	
+	// barrier 0 sleeper was never released
+	pthread_join(timed, &ret);
+	TEST_CHECK_((long) ret==-3, 0, "barrier 0 sleeper, exp: %d, got: %ld", -3, (long) ret);
+	
+	// out of range barrier
+	res = awake_barrier_id(test_group, LGROUP_BARRIERS);
+	TEST_CHECK_(res==-2 && errno==EINVAL, 0, "out of range barrier, got: %d", res);
+	
+	set_barrier_parties(test_group, COUNTING_BARRIER, 0);
+	lgroup_destroy(test_group);
+}
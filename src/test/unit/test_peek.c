@@ -0,0 +1,76 @@
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+
+void test_peek(void)
+{
+	char small[8], medium[16], large[64], *bufs[] = { large, small, medium };
+	unsigned long sizes[] = { sizeof(large), sizeof(small), sizeof(medium) };
+	char *msgs[3], *msg;
+	unsigned long needed;
+	int index, res = -1;
+	
+	// installing test group
+	struct lgroup_t *test_group = lgroup_init();
+	res = install_group(test_group, "peek");
+	TEST_ASSERT_(res>=0, 1, "test group - install ok");
+	
+	// group already existed
+	if(!res)
+	{
+		// reset group
+		set_send_delay(test_group, 0);
+		revoke_delayed_messages(test_group);
+		char msg[2];
+		while (deliver_message(test_group, msg, 2));  // empty message queue
+	}
+	
+	res = peek_message_size(test_group);
+	TEST_CHECK_(res==0, 0, "empty queue, exp: %d, got: %d", 0, res);
+	
+	msgs[0] = rand_string(10);
+	msgs[1] = rand_string(50);
+	msgs[2] = rand_string(5);
+	for (int i=0; i < 3; i++)
+		publish_message(test_group, msgs[i]);
+	
+	// peeking doesn't consume
+	res = peek_message_size(test_group);
+	TEST_CHECK_(res==10, 0, "peek, exp: %d, got: %d", 10, res);
+	res = peek_message_size(test_group);
+	TEST_CHECK_(res==10, 0, "second peek, exp: %d, got: %d", 10, res);
+	
+	// right-sized buffer
+	res = deliver_message_alloc(test_group, &msg);
+	TEST_CHECK_(res==10 && !strcmp(msg, msgs[0]), 0, "alloc delivery, exp: %d, got: %d", 10, res);
+	free(msg);
+	
+	// best fitting buffer
+	res = deliver_message_pool(test_group, bufs, sizes, 3, &index);
+	TEST_CHECK_(res==50 && index==0 && !strcmp(large, msgs[1]), 0, 
+			"pool delivery, exp: %d (0), got: %d (%d)", 50, res, index);
+	res = deliver_message_pool(test_group, bufs, sizes, 3, &index);
+	TEST_CHECK_(res==5 && index==1 && !strcmp(small, msgs[2]), 0, 
+			"pool delivery, exp: %d (1), got: %d (%d)", 5, res, index);
+	
+	// no truncation
+	publish_message(test_group, msgs[0]);
+	res = deliver_message_pool(test_group, bufs + 1, sizes + 1, 1, &index);
+	TEST_CHECK_(res==-3 && index==-1, 0, "no fitting buffer, exp: %d, got: %d", -3, res);
+	res = peek_message_size(test_group);
+	TEST_CHECK_(res==10, 0, "message still queued, exp: %d, got: %d", 10, res);
+	
+	// too small, then fitting, in a single call each
+	res = deliver_message_fit(test_group, small, sizeof(small), &needed);
+	TEST_CHECK_(res==0 && needed==10, 0, "fit delivery, exp: 0 (10), got: %d (%lu)", res, needed);
+	res = deliver_message_fit(test_group, medium, sizeof(medium), &needed);
+	TEST_CHECK_(res==10 && needed==0 && !strcmp(medium, msgs[0]), 0, 
+			"fit delivery, exp: 10 (0), got: %d (%lu)", res, needed);
+	
+	for (int i=0; i < 3; i++)
+		free(msgs[i]);
+	lgroup_destroy(test_group);
+}
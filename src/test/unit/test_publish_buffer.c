@@ -0,0 +1,78 @@
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+
+#define BUFFER_COUNT 4
+#define BUFFER_DELAY 300  // ms
+
+// messages in the queue, emptying it
+static int pending(struct lgroup_t *lgroup)
+{
+	char msg[32];
+	int n = 0;
+	
+	while (deliver_message(lgroup, msg, sizeof(msg)) > 0)
+		n++;
+	return n;
+}
+
+void test_publish_buffer(void)
+{
+	char msg[] = {'b', 0, 'i', 'n'};  // not a string
+	int res = -1;
+	
+	// writer and reader of the same group
+	struct lgroup_t *writer = lgroup_init(), *reader = lgroup_init();
+	res = install_group(writer, "buffer");
+	TEST_ASSERT_(res>=0, 1, "test group - install ok");
+	res = install_group(reader, "buffer");
+	TEST_ASSERT_(res==0, 1, "test group - second install ok");
+	
+	// reset group
+	set_send_delay(writer, 0);
+	revoke_delayed_messages(writer);
+	pending(reader);
+	
+	res = set_publish_buffer(writer, 1024, BUFFER_COUNT, BUFFER_DELAY);
+	TEST_ASSERT_(res==0, 1, "set publish buffer: %d", res);
+	
+	// count threshold
+	for (int i=0; i < BUFFER_COUNT-1; i++)
+	{
+		res = publish_buffered(writer, msg, sizeof(msg));
+		TEST_CHECK_(res==sizeof(msg), 0, "buffered publish, exp: %zu, got: %d", sizeof(msg), res);
+	}
+	res = pending(reader);
+	TEST_CHECK_(res==0, 0, "before count threshold, exp: %d, got: %d", 0, res);
+	publish_buffered(writer, msg, sizeof(msg));
+	res = pending(reader);
+	TEST_CHECK_(res==BUFFER_COUNT, 0, "count threshold, exp: %d, got: %d", BUFFER_COUNT, res);
+	
+	// deadline
+	publish_buffered(writer, msg, sizeof(msg));
+	msleep(BUFFER_DELAY - TEST_EPSILON);
+	res = pending(reader);
+	TEST_CHECK_(res==0, 0, "before deadline, exp: %d, got: %d", 0, res);
+	msleep(2 * TEST_EPSILON);
+	res = pending(reader);
+	TEST_CHECK_(res==1, 0, "deadline, exp: %d, got: %d", 1, res);
+	
+	// explicit flush
+	publish_buffered(writer, msg, sizeof(msg));
+	publish_buffered(writer, msg, sizeof(msg));
+	res = flush_messages(writer);
+	TEST_CHECK_(res==2, 0, "flush, exp: %d, got: %d", 2, res);
+	res = pending(reader);
+	TEST_CHECK_(res==2, 0, "flushed, exp: %d, got: %d", 2, res);
+	
+	// finalization flushes
+	publish_buffered(writer, msg, sizeof(msg));
+	lgroup_destroy(writer);
+	res = pending(reader);
+	TEST_CHECK_(res==1, 0, "destroy, exp: %d, got: %d", 1, res);
+	
+	lgroup_destroy(reader);
+}
@@ -0,0 +1,43 @@
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+
+void test_stats(void)
+{
+	struct lgroup_stats_t stats;
+	char buf[100], *msg, *big;
+	
+	// fresh group, counters start from 0
+	struct lgroup_t *test_group = lgroup_init();
+	char *id = rand_string(32);
+	int res = install_group(test_group, id);
+	free(id);
+	TEST_ASSERT_(res==1, 0, "stats group install: %d", res);
+	
+	msg = rand_string(10);
+	big = rand_string(200);  // over the default max_message_size
+	TEST_CHECK_(publish_message(test_group, msg)==10, 0, "first publish: %s", strerror(errno));
+	TEST_CHECK_(publish_message(test_group, msg)==10, 0, "second publish: %s", strerror(errno));
+	TEST_CHECK_(publish_message(test_group, big)==-2 && errno==EMSGSIZE, 0, "oversized publish");
+	TEST_CHECK_(deliver_message(test_group, buf, 100)==10, 0, "deliver: %s", strerror(errno));
+	free(msg);
+	free(big);
+	
+	res = get_group_stats(test_group, &stats);
+	TEST_ASSERT_(!res, 0, "read stats: %s", strerror(errno));
+	TEST_CHECK_(stats.msgs_written == 2 && stats.bytes_written == 20, 0, 
+			"written: %llu msgs %llu bytes, expected 2 20.", stats.msgs_written, stats.bytes_written);
+	TEST_CHECK_(stats.msgs_read == 1 && stats.bytes_read == 10, 0, 
+			"read: %llu msgs %llu bytes, expected 1 10.", stats.msgs_read, stats.bytes_read);
+	TEST_CHECK_(stats.rejected_msgsize == 1 && stats.rejected_nospc == 0, 0, 
+			"rejected: %llu msgsize %llu nospc, expected 1 0.", 
+			stats.rejected_msgsize, stats.rejected_nospc);
+	TEST_CHECK_(stats.size == 10 && stats.peak_size == 20, 0, 
+			"size: %lu peak %lu, expected 10 20.", stats.size, stats.peak_size);
+	
+	uninstall_group(test_group);
+	lgroup_destroy(test_group);
+}
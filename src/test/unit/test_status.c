@@ -0,0 +1,56 @@
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+
+void test_status(void)
+{
+	struct lgroup_status_t status;
+	char buf[100], *msg;
+	
+	struct lgroup_t *test_group = lgroup_init();
+	char *id = rand_string(32);
+	int res = install_group(test_group, id);
+	free(id);
+	TEST_ASSERT_(res==1, 0, "status group install: %d", res);
+	
+	// the page is mapped before any publication, then kept up to date
+	res = get_group_status(test_group, &status);
+	TEST_ASSERT_(!res, 0, "map status: %s", strerror(errno));
+	TEST_CHECK_(!status.published && !status.queued && !status.size, 0, "fresh group status");
+	
+	// empty queue: readiness checked in userspace, idle readers time out
+	struct timespec timeout = { 0, 10000000 };
+	TEST_CHECK_(deliver_message(test_group, buf, 100)==0, 0, "empty deliver");
+	res = wait_messages(test_group, &timeout, 0);
+	TEST_CHECK_(res==-3, 0, "empty wait: %d, expected -3.", res);
+	
+	msg = rand_string(10);
+	TEST_CHECK_(publish_message(test_group, msg)==10, 0, "first publish: %s", strerror(errno));
+	TEST_CHECK_(publish_message(test_group, msg)==10, 0, "second publish: %s", strerror(errno));
+	res = wait_messages(test_group, NULL, 0);
+	TEST_CHECK_(!res, 0, "wait with queued messages: %d", res);
+	TEST_CHECK_(deliver_message(test_group, buf, 100)==10, 0, "deliver: %s", strerror(errno));
+	TEST_CHECK_(!set_send_delay(test_group, 10000), 0, "set delay: %s", strerror(errno));
+	TEST_CHECK_(publish_message(test_group, msg)==10, 0, "delayed publish: %s", strerror(errno));
+	free(msg);
+	
+	res = get_group_status(test_group, &status);
+	TEST_ASSERT_(!res, 0, "read status: %s", strerror(errno));
+	TEST_CHECK_(status.published == 2 && status.delivered == 1 && status.queued == 1, 0, 
+			"messages: %llu published %llu delivered %llu queued, expected 2 1 1.", 
+			status.published, status.delivered, status.queued);
+	TEST_CHECK_(status.delayed == 1 && status.size == 20, 0, 
+			"delayed: %llu, size: %llu, expected 1 20.", status.delayed, status.size);
+	
+	// revoked messages leave both counters
+	TEST_CHECK_(!revoke_delayed_messages(test_group), 0, "revoke: %s", strerror(errno));
+	res = get_group_status(test_group, &status);
+	TEST_CHECK_(!res && status.delayed == 0 && status.size == 10, 0, 
+			"after revoke: %llu delayed, %llu bytes, expected 0 10.", status.delayed, status.size);
+	
+	uninstall_group(test_group);
+	lgroup_destroy(test_group);
+}
@@ -0,0 +1,39 @@
+#define TEST_NO_MAIN
+#include "acutest.h"
+
+#include "utils.h"
+#include "lgroups.h"
+
+
+void test_uninstall_group(void)
+{
+	struct lgroup_t *old_group = lgroup_init(), *new_group = lgroup_init();
+	char *group_id = rand_string(32), buf[32];
+	int res = -1;
+	
+	// installing test group, leaving a message unread
+	res = install_group(old_group, group_id);
+	TEST_ASSERT_(res==1, 1, "test group - install ok, got: %d", res);
+	res = publish_message(old_group, "unread");
+	TEST_ASSERT_(res>0, 1, "publish, got: %d", res);
+	
+	res = uninstall_group(old_group);
+	TEST_CHECK_(res==0, 0, "uninstall, exp: %d, got: %d", 0, res);
+	res = uninstall_group(old_group);
+	TEST_CHECK_(res==-3, 0, "second uninstall, exp: %d, got: %d", -3, res);
+	
+	// members keep using the uninstalled group
+	res = deliver_message(old_group, buf, sizeof(buf));
+	TEST_CHECK_(res>0 && !strcmp(buf, "unread"), 0, "deliver after uninstall, got: %d", res);
+	
+	// the id is free again, for a brand new group
+	res = install_group(new_group, group_id);
+	TEST_CHECK_(res==1, 0, "reinstall, exp: %d, got: %d", 1, res);
+	res = publish_message(old_group, "old");
+	res = deliver_message(new_group, buf, sizeof(buf));
+	TEST_CHECK_(res==0, 0, "new group is empty, exp: %d, got: %d", 0, res);
+	
+	free(group_id);
+	lgroup_destroy(old_group);  // last close, the old group is released
+	lgroup_destroy(new_group);
+}
@@ -1,23 +1,55 @@
 #include "acutest.h"
 
 void test_install_group(void);
+void test_uninstall_group(void);
+void test_install_group_fd(void);
+void test_install_groups(void);
+void test_groupfs(void);
 void test_rw_fifo(void);
+void test_peek(void);
+void test_deliver_messages(void);
 void test_delay(void);
 void test_flush(void);
+void test_publish_buffer(void);
+void test_async(void);
 void test_sysfs(void);
+void test_config(void);
+void test_stats(void);
+void test_status(void);
 void test_max_install(void);
 void test_barrier(void);
+void test_counting_barrier(void);
+void test_barrier_timeout(void);
+void test_multi_barrier(void);
+void test_barrier_payload(void);
+void test_barrier_release(void);
 void test_revoke(void);
 void test_stress(void);
 
 TEST_LIST = {
 	{"install group", test_install_group},
+	{"uninstall group", test_uninstall_group},
+	{"install group fd", test_install_group_fd},
+	{"batch install", test_install_groups},
+	{"groupfs", test_groupfs},
 	{"r/w FIFO order", test_rw_fifo},
+	{"peek message size", test_peek},
+	{"batched delivery", test_deliver_messages},
 	{"delayed operating mode", test_delay},
 	{"sysfs attributes", test_sysfs},
+	{"group config", test_config},
+	{"group stats", test_stats},
+	{"status page", test_status},
 	{"barrier", test_barrier},
+	{"counting barrier", test_counting_barrier},
+	{"barrier timeout", test_barrier_timeout},
+	{"multiple barriers", test_multi_barrier},
+	{"barrier payload", test_barrier_payload},
+	{"barrier release", test_barrier_release},
 	{"revoke delayed messages", test_revoke},
 	{"flush", test_flush},
+	{"buffered publisher", test_publish_buffer},
+	{"async operations", test_async},
 	{"stress 10s", test_stress},
 	{"max installs", test_max_install},
 	{0}
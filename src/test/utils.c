@@ -1,40 +1,47 @@
-#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
 
+#include "groups.h"
 #include "utils.h"
 
 
 int next_group()
 {
-	struct dirent *dp;
-	DIR *dfd;
-
-	char *dir = "/dev";
-
-	if ((dfd = opendir(dir)) == NULL) {
-		fprintf(stderr, "Can't open %s.\n", dir);
+	struct group_fd_t probe = { .installed = 0 };
+	int fd, fd_probe, n;
+	char *id;
+	
+	// groups installed through descriptors have no node in /dev: 
+	// ask the module, minors are allocated cyclically
+	if ((fd = open("/dev/group0", O_RDWR)) == -1) {
+		fprintf(stderr, "Can't open /dev/group0.\n");
 		return 0;
 	}
-
-	char devname[100];
-	int n = -1;
 	
-	while ((dp = readdir(dfd)) != NULL) {
-		sprintf(devname, "%s", dp->d_name);
-		if(!strncmp(devname,"group",5))
-		{
-			int m;
-			if(!sscanf(devname, "group%d", &m))
-			{
-				printf("Can't read group number.\n");
-			}
-			n = m>n ? m : n;
-		}
+	id = rand_string(32);
+	strncpy(probe.group.id, id, 32);
+	free(id);
+	
+	if ((fd_probe = ioctl(fd, INSTALL_GROUP_FD, &probe)) == -1) {
+		fprintf(stderr, "Can't install a probe group.\n");
+		close(fd);
+		return 0;
 	}
+	if(sscanf(probe.group.devname, "group%d", &n) != 1)
+	{
+		printf("Can't read group number.\n");
+		n = -1;
+	}
+	
+	ioctl(fd_probe, UNINSTALL_GROUP, &probe.group);
+	close(fd_probe);
+	close(fd);
 	
 	return n+1;
 }